@@ -0,0 +1,332 @@
+// Benchmark sweep, steps headless worlds over scenario x particle count x thread count and writes one row each
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "scheduler.h"
+#include "topology.h"
+#include "world.h"
+
+// One measured combination
+struct BenchResult {
+    Scenario scenario;
+    int count;
+    int threads;
+    bool collisions;
+    float radiusScale;
+    int reps;
+    int steps;
+    double meanMs;
+    double medianMs;
+    double p99Ms;
+    double minMs;
+    double maxMs;
+    double updatesPerSecond;
+    PlacementPolicy placement;
+    std::string cpus; // CPU of every worker separated by spaces, "-" for an unpinned one
+};
+
+// Comma separated list of integers, returns false on anything that is not a number
+static bool ParseIntList(const char* text, std::vector<int>& values) {
+    values.clear();
+    std::string list(text);
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t comma = list.find(',', start);
+        std::string item = list.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+        char* end = nullptr;
+        long value = strtol(item.c_str(), &end, 10);
+        if (item.empty() || *end != '\0') return false;
+        values.push_back((int)value);
+        if (comma == std::string::npos) break;
+        start = comma + 1;
+    }
+    return !values.empty();
+}
+
+static bool ParseScenarioList(const char* text, std::vector<Scenario>& scenarios) {
+    scenarios.clear();
+    std::string list(text);
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t comma = list.find(',', start);
+        std::string item = list.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+        Scenario scenario;
+        if (!ParseScenario(item.c_str(), scenario)) return false;
+        scenarios.push_back(scenario);
+        if (comma == std::string::npos) break;
+        start = comma + 1;
+    }
+    return !scenarios.empty();
+}
+
+// The game is timed with Main Game Multi's setup (PileGameConfig). Discs covering more than this share of the world
+// cannot all fit, so the pile stays overlapped and its contacts and times say little about a real game.
+static const double kMaxCoverage = 0.8;
+
+// Share of the world the particles' discs would cover if none overlapped
+static double Coverage(const World& world) {
+    const ParticleStore& particles = world.Particles();
+    double area = 0.0;
+    for (int i = 0; i < particles.Size(); i++) area += M_PI * particles.radius[i] * particles.radius[i];
+    return area / ((double)world.Config().width * world.Config().height);
+}
+
+// Nearest-rank percentile of sorted step times
+static double Percentile(const std::vector<double>& sorted, double percent) {
+    if (sorted.empty()) return 0.0;
+    size_t rank = (size_t)std::ceil(percent / 100.0 * sorted.size());
+    return sorted[std::min(std::max(rank, (size_t)1), sorted.size()) - 1];
+}
+
+static BenchResult RunOne(const WorldConfig& config, TaskScheduler& scheduler, int warmup, int reps, int steps, float dt) {
+    const bool parallel = scheduler.WorkerCount() > 1;
+    World world = parallel ? World(config, scheduler) : World(config);
+    const double coverage = Coverage(world);
+    if (config.collisions && coverage > kMaxCoverage) {
+        fprintf(stderr, "Warning: %d %s particles cover %.0f%% of the world, more than fit without overlapping\n",
+                config.particleCount, ScenarioName(config.scenario), coverage * 100.0);
+    }
+
+    for (int i = 0; i < warmup; i++) {
+        if (parallel) world.Step(dt, scheduler);
+        else world.Step(dt);
+    }
+
+    // Every rep starts from the same spawn so reps measure the same work
+    std::vector<double> stepMs;
+    stepMs.reserve((size_t)reps * steps);
+    for (int rep = 0; rep < reps; rep++) {
+        if (rep > 0) {
+            if (parallel) world.Reset(scheduler);
+            else world.Reset();
+            for (int i = 0; i < warmup; i++) {
+                if (parallel) world.Step(dt, scheduler);
+                else world.Step(dt);
+            }
+        }
+
+        for (int i = 0; i < steps; i++) {
+            auto start = std::chrono::high_resolution_clock::now();
+            if (parallel) world.Step(dt, scheduler);
+            else world.Step(dt);
+            auto end = std::chrono::high_resolution_clock::now();
+            stepMs.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+        }
+    }
+
+    std::vector<double> sorted = stepMs;
+    std::sort(sorted.begin(), sorted.end());
+
+    double total = 0.0;
+    for (double ms : stepMs) total += ms;
+
+    BenchResult result;
+    result.scenario = config.scenario;
+    result.count = config.particleCount;
+    result.threads = scheduler.WorkerCount();
+    result.collisions = config.collisions;
+    result.radiusScale = config.radiusScale;
+    result.reps = reps;
+    result.steps = steps;
+    result.meanMs = stepMs.empty() ? 0.0 : total / stepMs.size();
+    result.medianMs = Percentile(sorted, 50.0);
+    result.p99Ms = Percentile(sorted, 99.0);
+    result.minMs = sorted.empty() ? 0.0 : sorted.front();
+    result.maxMs = sorted.empty() ? 0.0 : sorted.back();
+    result.updatesPerSecond = result.meanMs > 0.0 ? config.particleCount / (result.meanMs / 1000.0) : 0.0;
+    return result;
+}
+
+static void WriteCsvHeader(FILE* out) {
+    fprintf(out, "scenario,count,threads,collisions,reps,steps,mean_ms,median_ms,p99_ms,min_ms,max_ms,updates_per_s,placement,cpus,radius_scale\n");
+}
+
+static void WriteCsvRow(FILE* out, const BenchResult& r) {
+    fprintf(out, "%s,%d,%d,%d,%d,%d,%.6f,%.6f,%.6f,%.6f,%.6f,%.6e,%s,%s,%.3f\n", ScenarioName(r.scenario), r.count,
+            r.threads, r.collisions ? 1 : 0, r.reps, r.steps, r.meanMs, r.medianMs, r.p99Ms, r.minMs, r.maxMs,
+            r.updatesPerSecond, PlacementPolicyName(r.placement), r.cpus.c_str(), r.radiusScale);
+}
+
+static void WriteJson(FILE* out, const std::vector<BenchResult>& results) {
+    fprintf(out, "[\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        fprintf(out, "  {\"scenario\": \"%s\", \"count\": %d, \"threads\": %d, \"collisions\": %s, \"reps\": %d, \"steps\": %d, "
+                     "\"mean_ms\": %.6f, \"median_ms\": %.6f, \"p99_ms\": %.6f, \"min_ms\": %.6f, \"max_ms\": %.6f, "
+                     "\"updates_per_s\": %.6e, \"placement\": \"%s\", \"cpus\": \"%s\", \"radius_scale\": %.3f}%s\n",
+                ScenarioName(r.scenario), r.count, r.threads, r.collisions ? "true" : "false", r.reps, r.steps, r.meanMs,
+                r.medianMs, r.p99Ms, r.minMs, r.maxMs, r.updatesPerSecond, PlacementPolicyName(r.placement),
+                r.cpus.c_str(), r.radiusScale, i + 1 < results.size() ? "," : "");
+    }
+    fprintf(out, "]\n");
+}
+
+static void PrintUsage(const char* program) {
+    printf("Usage: %s [options]\n", program);
+    printf("  --scenarios LIST  comma separated bounce, rain, game (default bounce,rain,game)\n");
+    printf("  --counts LIST     comma separated particle counts (default 10000,100000,1000000, game 5000,10000,20000)\n");
+    printf("  --threads LIST    comma separated worker counts, 0 uses every core unless that count is listed too\n");
+    printf("                    (default 1,2,4,0)\n");
+    printf("  --warmup N        unmeasured steps before each rep (default 30)\n");
+    printf("  --steps N         measured steps per rep (default 200)\n");
+    printf("  --reps N          repetitions per combination (default 3)\n");
+    printf("  --dt SECONDS      step length (default 1/60)\n");
+    printf("  --placement NAME  pin workers: none, physical (physical cores first) or numa (one node) (default none)\n");
+    printf("  --reserve N       physical cores to keep free of pinned workers, needs --placement physical or numa\n");
+    printf("  --collisions      enable collisions in every scenario, the game always has them\n");
+    printf("  --format FORMAT   csv or json (default csv)\n");
+    printf("  --output FILE     write results to FILE instead of stdout\n");
+}
+
+int main(int argc, char** argv) {
+    std::vector<Scenario> scenarios = {Scenario::Bounce, Scenario::Rain, Scenario::Game};
+    std::vector<int> counts = {10000, 100000, 1000000};
+    std::vector<int> gameCounts = {5000, 10000, 20000};
+    std::vector<int> threadCounts = {1, 2, 4, 0};
+    int warmup = 30;
+    int steps = 200;
+    int reps = 3;
+    float dt = 1.0f / 60.0f;
+    bool collisions = false;
+    bool json = false;
+    PlacementPolicy placementPolicy = PlacementPolicy::None;
+    int reservedCores = 0;
+    const char* outputPath = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+
+        if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0) {
+            PrintUsage(argv[0]);
+            return 0;
+        }
+        if (strcmp(arg, "--collisions") == 0) {
+            collisions = true;
+            continue;
+        }
+        if (!value) {
+            fprintf(stderr, "Missing value for %s\n", arg);
+            return 1;
+        }
+
+        bool valid = true;
+        if (strcmp(arg, "--scenarios") == 0) {
+            valid = ParseScenarioList(value, scenarios);
+        } else if (strcmp(arg, "--counts") == 0) {
+            valid = ParseIntList(value, counts);
+            gameCounts = counts;
+        } else if (strcmp(arg, "--threads") == 0) {
+            valid = ParseIntList(value, threadCounts);
+        } else if (strcmp(arg, "--placement") == 0) {
+            valid = ParsePlacementPolicy(value, placementPolicy);
+        } else if (strcmp(arg, "--reserve") == 0) {
+            reservedCores = atoi(value);
+        } else if (strcmp(arg, "--warmup") == 0) {
+            warmup = atoi(value);
+        } else if (strcmp(arg, "--steps") == 0) {
+            steps = atoi(value);
+        } else if (strcmp(arg, "--reps") == 0) {
+            reps = atoi(value);
+        } else if (strcmp(arg, "--dt") == 0) {
+            dt = (float)atof(value);
+        } else if (strcmp(arg, "--format") == 0) {
+            if (strcmp(value, "json") == 0) json = true;
+            else valid = strcmp(value, "csv") == 0;
+        } else if (strcmp(arg, "--output") == 0) {
+            outputPath = value;
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", arg);
+            PrintUsage(argv[0]);
+            return 1;
+        }
+        if (!valid) {
+            fprintf(stderr, "Invalid value for %s: %s\n", arg, value);
+            return 1;
+        }
+        i++;
+    }
+
+    // Unpinned workers can run anywhere, so keeping cores free only means something when the workers are pinned
+    if (reservedCores > 0 && placementPolicy == PlacementPolicy::None) {
+        fprintf(stderr, "--reserve needs --placement physical or numa\n");
+        return 1;
+    }
+
+    FILE* out = stdout;
+    if (outputPath) {
+        out = fopen(outputPath, "w");
+        if (!out) {
+            fprintf(stderr, "Cannot open %s\n", outputPath);
+            return 1;
+        }
+    }
+
+    // CSV rows stream out as they finish so a long sweep can be watched, JSON is written at the end
+    if (!json) WriteCsvHeader(out);
+    std::vector<BenchResult> results;
+
+    CpuTopology topology = CpuTopology::Detect();
+    fprintf(stderr, "Topology: %d cpus, %d cores, %d %s%s\n", topology.CpuCount(), topology.CoreCount(),
+            topology.NodeCount(), topology.NodeCount() == 1 ? "node" : "nodes",
+            topology.FromSysfs() ? "" : " (sysfs not available)");
+
+    std::vector<int> measured;
+    for (int threads : threadCounts) {
+        // One pool per thread count, reused across every scenario and size. The main thread is worker 0.
+        PlacementConfig placementConfig;
+        placementConfig.policy = placementPolicy;
+        placementConfig.threads = threads;
+        placementConfig.reservedCores = reservedCores;
+        WorkerPlacement placement = PlaceWorkers(topology, placementConfig);
+
+        // 0 on a small machine often resolves to a count the list already has, measuring it twice adds nothing
+        const int resolved = placement.ThreadCount();
+        const bool listed = threads == 0 && std::find(threadCounts.begin(), threadCounts.end(), resolved) != threadCounts.end();
+        if (listed || std::find(measured.begin(), measured.end(), resolved) != measured.end()) {
+            fprintf(stderr, "Skipping %d threads, already measured\n", resolved);
+            continue;
+        }
+        measured.push_back(resolved);
+        WorkerPool pool(placement);
+        TaskScheduler scheduler(pool);
+        const int mainCpu = placement.cpus[0] >= 0 && PinCurrentThread(placement.cpus[0]) ? placement.cpus[0] : -1;
+        fprintf(stderr, "Placement: %s\n", placement.Describe().c_str());
+
+        std::string cpus;
+        for (int worker = 0; worker < pool.ThreadCount(); worker++) {
+            int cpu = worker == 0 ? mainCpu : pool.Cpu(worker);
+            if (worker > 0) cpus += " ";
+            cpus += cpu >= 0 ? std::to_string(cpu) : "-";
+        }
+
+        for (Scenario scenario : scenarios) {
+            const bool game = scenario == Scenario::Game;
+            for (int count : game ? gameCounts : counts) {
+                WorldConfig config = game ? PileGameConfig(count) : DefaultConfig(scenario);
+                config.particleCount = count;
+                config.collisions = collisions || game;
+
+                BenchResult result = RunOne(config, scheduler, warmup, reps, steps, dt);
+                result.placement = placement.policy;
+                result.cpus = cpus;
+                results.push_back(result);
+                if (!json) {
+                    WriteCsvRow(out, result);
+                    fflush(out);
+                }
+                fprintf(stderr, "%s %d particles, %d threads: %.4f ms mean\n", ScenarioName(scenario), count, result.threads, result.meanMs);
+            }
+        }
+    }
+
+    if (json) WriteJson(out, results);
+    if (out != stdout) fclose(out);
+    return 0;
+}
@@ -0,0 +1,762 @@
+// Headless driver, steps a world without opening a window
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "draw_batch.h"
+#include "frame_graph.h"
+#include "kernels.h"
+#include "random.h"
+#include "scheduler.h"
+#include "topology.h"
+#include "trace.h"
+#include "world.h"
+
+// Kernel inputs and outputs compared between the scalar and SIMD paths
+struct KernelState {
+    std::vector<float> x, y, vx, vy, radius;
+    std::vector<int> respawned;
+};
+
+static KernelState RandomKernelState(int count, float width, float height, unsigned int seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> posX(-20.0f, width + 20.0f);
+    std::uniform_real_distribution<float> posY(-20.0f, height + 20.0f);
+    std::uniform_real_distribution<float> speed(-15.0f, 15.0f);
+    std::uniform_real_distribution<float> size(0.0f, 20.0f);
+
+    KernelState state;
+    for (int i = 0; i < count; i++) {
+        state.x.push_back(posX(rng));
+        state.y.push_back(posY(rng));
+        state.vx.push_back(speed(rng));
+        state.vy.push_back(speed(rng));
+        state.radius.push_back(size(rng));
+
+        // Exact wall contact and signed zero velocities are the usual places for a SIMD port to drift
+        if (i % 7 == 0) state.x[i] = state.radius[i];
+        if (i % 11 == 0) state.y[i] = height - state.radius[i];
+        if (i % 13 == 0) state.vx[i] = -0.0f;
+        if (i % 17 == 0) state.vy[i] = 0.0f;
+    }
+    state.respawned.assign(count, -1);
+    return state;
+}
+
+// Thin platforms scattered over the lower three quarters of the world, the same for a given seed
+static std::vector<Aabb> RandomPlatforms(int count, float width, float height, unsigned int seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> left(0.0f, width - 40.0f);
+    std::uniform_real_distribution<float> top(height * 0.25f, height - 20.0f);
+    std::uniform_real_distribution<float> length(20.0f, 120.0f);
+    std::uniform_real_distribution<float> thickness(4.0f, 12.0f);
+
+    std::vector<Aabb> platforms;
+    for (int i = 0; i < count; i++) {
+        Aabb box;
+        box.minX = left(rng);
+        box.minY = top(rng);
+        box.maxX = box.minX + length(rng);
+        box.maxY = box.minY + thickness(rng);
+        platforms.push_back(box);
+    }
+    return platforms;
+}
+
+static KernelArgs ArgsFor(KernelState& state, float width, float height, float dt) {
+    return {state.x.data(), state.y.data(), state.vx.data(), state.vy.data(), state.radius.data(), width, height, dt};
+}
+
+static bool SameBits(const std::vector<float>& a, const std::vector<float>& b) {
+    return memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0;
+}
+
+static bool SameState(const KernelState& a, const KernelState& b) {
+    return SameBits(a.x, b.x) && SameBits(a.y, b.y) && SameBits(a.vx, b.vx) && SameBits(a.vy, b.vy) && a.respawned == b.respawned;
+}
+
+// Run every SIMD kernel set the CPU supports against the scalar kernels and compare the bits
+static int VerifyKernels() {
+    const int count = 4099; // not a multiple of any vector width so the tails run too
+    const int begin = 3;
+    const int end = count - 5;
+    const int steps = 200;
+    const float width = 800.0f;
+    const float height = 600.0f;
+    const float dt = 1.0f / 60.0f;
+
+    const KernelSet& scalar = ScalarKernels();
+    const KernelSet* candidates[] = {SseKernels(), Avx2Kernels(), Avx512Kernels()};
+    int failures = 0;
+
+    for (const KernelSet* simd : candidates) {
+        if (!simd) continue;
+        if (!CpuSupports(simd->isa)) {
+            printf("%-7s skipped, not supported by this CPU\n", simd->name);
+            continue;
+        }
+
+        // The game runs twice, the second time at 144 Hz so drag is a fractional power of GAME_DRAG
+        for (int scenario = 0; scenario < 4; scenario++) {
+            const float scenarioDt = scenario == 3 ? 1.0f / 144.0f : dt;
+            KernelState expected = RandomKernelState(count, width, height, 1234 + scenario);
+            KernelState actual = expected;
+            KernelArgs expectedArgs = ArgsFor(expected, width, height, scenarioDt);
+            KernelArgs actualArgs = ArgsFor(actual, width, height, scenarioDt);
+            bool same = true;
+
+            for (int step = 0; step < steps && same; step++) {
+                if (scenario == 0) {
+                    scalar.bounce(expectedArgs, begin, end);
+                    simd->bounce(actualArgs, begin, end);
+                } else if (scenario == 1) {
+                    int expectedCount = scalar.rain(expectedArgs, begin, end, expected.respawned.data());
+                    int actualCount = simd->rain(actualArgs, begin, end, actual.respawned.data());
+                    same = expectedCount == actualCount;
+
+                    // Send respawned drops back to the top the same way on both sides
+                    for (int j = 0; j < expectedCount; j++) expected.y[expected.respawned[j]] = -10.0f;
+                    for (int j = 0; j < actualCount; j++) actual.y[actual.respawned[j]] = -10.0f;
+                } else {
+                    KernelPlayer player = {width / 2 + step, height - 200.0f, 150.0f, 150.0f, 5.0f, step % 3 - 1};
+                    scalar.game(expectedArgs, player, begin, end);
+                    simd->game(actualArgs, player, begin, end);
+                }
+                same = same && SameState(expected, actual);
+            }
+
+            const char* names[] = {"bounce", "rain", "game", "game144"};
+            printf("%-7s %-7s %s\n", simd->name, names[scenario], same ? "bit-identical" : "MISMATCH");
+            if (!same) failures++;
+        }
+    }
+
+    // Batched counter-based random blocks against one Philox call per index
+    {
+        CounterRandom random(1234);
+        std::vector<int> indices;
+        for (int i = 0; i < count; i++) indices.push_back(i * 7919);
+        std::vector<RandomBlock> blocks(count);
+        random.FillBlocks(RandomStream::Respawn, indices.data(), count, 0x123456789ull, 3, blocks.data());
+
+        bool same = true;
+        for (int i = 0; i < count; i++) {
+            RandomBlock expected = random.Block(RandomStream::Respawn, indices[i], 0x123456789ull, 3);
+            same = same && memcmp(&expected, &blocks[i], sizeof(RandomBlock)) == 0;
+        }
+        printf("%-7s %-7s %s\n", RandomUsesAvx2() ? "avx2" : "scalar", "random", same ? "bit-identical" : "MISMATCH");
+        if (!same) failures++;
+    }
+
+    return failures == 0 ? 0 : 1;
+}
+
+// Step the same world with different thread counts, grain sizes and kernels and compare the state hash after
+// every step against a serial run
+static int VerifyDeterminism(const WorldConfig& config, int steps, float dt, int threads) {
+    std::vector<uint64_t> expected;
+    {
+        World world(config);
+        expected.push_back(world.StateHash());
+        for (int i = 0; i < steps; i++) {
+            world.Step(dt);
+            expected.push_back(world.StateHash());
+        }
+    }
+    printf("serial            %016llx after %d steps\n", (unsigned long long)expected.back(), steps);
+
+    struct Variant {
+        int threads;
+        int grain;
+        KernelIsa simd;
+    };
+    const Variant variants[] = {
+        {1, config.grainSize, KernelIsa::Scalar},
+        {2, config.grainSize, config.simd},
+        {3, 61, config.simd},
+        {threads > 4 ? threads : 4, 4096, config.simd},
+    };
+
+    int failures = 0;
+    for (const Variant& variant : variants) {
+        WorldConfig variantConfig = config;
+        variantConfig.grainSize = variant.grain;
+        variantConfig.simd = variant.simd;
+
+        WorkerPool pool(variant.threads);
+        TaskScheduler scheduler(pool);
+        World world(variantConfig);
+        if (pool.ThreadCount() > 1) world.Reset(scheduler);
+
+        int mismatch = world.StateHash() == expected[0] ? -1 : 0;
+        for (int i = 0; i < steps && mismatch < 0; i++) {
+            if (pool.ThreadCount() > 1) {
+                world.Step(dt, scheduler);
+                if (world.StateHash(scheduler) != expected[i + 1]) mismatch = i + 1;
+            } else {
+                world.Step(dt);
+                if (world.StateHash() != expected[i + 1]) mismatch = i + 1;
+            }
+        }
+
+        printf("%d threads %-7s grain %-5d ", pool.ThreadCount(), world.Kernels().name, variant.grain);
+        if (mismatch < 0) {
+            printf("bit-identical\n");
+        } else {
+            printf("MISMATCH at step %d\n", mismatch);
+            failures++;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+// Whether the particle behind a handle is swapped for a fresh one before this step. Drawn by slot and step, so
+// the same particles churn however the store is split between workers.
+static bool Churns(const CounterRandom& random, ParticleHandle handle, long long step, float chance) {
+    return random.Block(RandomStream::Churn, handle.slot, (uint64_t)step).word[0] < (uint32_t)(chance * 4294967295.0f);
+}
+
+// Every particle leaves with the given chance and a copy of it drops back in from the top of the world. Both are
+// queued on the pool from the workers and applied at the end of the next step.
+static void QueueChurn(World& world, TaskScheduler* scheduler, const CounterRandom& random, float chance) {
+    ParticlePool& pool = world.Pool();
+    const ParticleStore& particles = world.Particles();
+    const long long step = world.StepCount();
+    auto queue = [&](int begin, int end, int worker) {
+        for (int i = begin; i < end; i++) {
+            ParticleHandle handle = pool.HandleOf(i);
+            if (!Churns(random, handle, step, chance)) continue;
+
+            Particle p = particles.Get(i);
+            p.position.y = p.radius;
+            p.still = 0;
+            pool.QueueDespawn(worker, handle);
+            pool.QueueSpawn(worker, handle.slot, p);
+        }
+    };
+
+    if (scheduler && scheduler->WorkerCount() > 1) {
+        pool.ReserveWorkers(scheduler->WorkerCount());
+        scheduler->ParallelFor(0, particles.Size(), DEFAULT_GRAIN_SIZE, queue);
+    } else {
+        queue(0, particles.Size(), 0);
+    }
+}
+
+// Churn the world from the workers with several thread counts and compare the state hash after every step against
+// a serial run. Along the way check that every churned handle goes stale, that stale and repeated despawns are
+// ignored, and that World::Spawn and World::Despawn keep their handles pointing at the right particles.
+static int VerifyPool(const WorldConfig& config, int steps, float dt, float chance) {
+    const CounterRandom random(config.seed);
+    const int threadCounts[] = {1, 2, 3, 4};
+    std::vector<uint64_t> expected;
+    int failures = 0;
+
+    for (int threads : threadCounts) {
+        WorkerPool pool(threads);
+        TaskScheduler scheduler(pool);
+        World world = pool.ThreadCount() > 1 ? World(config, scheduler) : World(config);
+        const int workers = pool.ThreadCount();
+        world.Pool().ReserveWorkers(workers);
+
+        std::vector<ParticleHandle> churned;
+        std::vector<ParticleHandle> stale;
+        ParticleHandle spawned;
+        uint64_t hash = 0;
+        const char* problem = nullptr;
+        int step = 0;
+
+        for (; step < steps && !problem; step++) {
+            // Last step's churned handles are stale by now, despawning them again must not remove anything
+            stale.swap(churned);
+            churned.clear();
+            for (int i = 0; i < world.ParticleCount(); i++) {
+                ParticleHandle handle = world.Pool().HandleOf(i);
+                if (Churns(random, handle, world.StepCount(), chance)) churned.push_back(handle);
+            }
+            for (size_t k = 0; k < stale.size(); k++) {
+                if (world.Pool().Alive(stale[k]) || world.Despawn(stale[k])) problem = "stale handle still alive";
+                world.Pool().QueueDespawn((int)k % workers, stale[k]);
+            }
+
+            // The same despawn queued twice from different workers only removes the particle once
+            QueueChurn(world, &scheduler, random, chance);
+            for (size_t k = 0; k < churned.size(); k++) world.Pool().QueueDespawn((int)(k + 1) % workers, churned[k]);
+
+            // A particle added and removed between steps, its handle has to find it wherever partitioning moved it
+            if (step % 10 == 0 && world.ParticleCount() > 0) {
+                Particle p = world.Particles().Get(0);
+                p.position = {config.width / 2, config.height / 4 + step};
+                p.still = 0;
+                spawned = world.Spawn(p);
+                int index = world.Pool().IndexOf(spawned);
+                if (spawned.Valid() && (index < 0 || world.Particles().y[index] != p.position.y)) problem = "spawned handle lost";
+            } else if (step % 10 == 5 && spawned.Valid()) {
+                // Churn may have taken it already, then the handle is stale
+                bool alive = world.Pool().Alive(spawned);
+                if (world.Despawn(spawned) != alive || world.Despawn(spawned)) problem = "despawn of a spawned handle";
+            }
+
+            const int before = world.ParticleCount();
+            if (workers > 1) {
+                world.Step(dt, scheduler);
+            } else {
+                world.Step(dt);
+            }
+            for (ParticleHandle handle : churned) {
+                if (world.Pool().Alive(handle)) problem = "churned handle still alive";
+            }
+            if (!world.Pool().HasMortal() && config.emitters.empty() && world.ParticleCount() != before) problem = "particle count changed";
+
+            hash = workers > 1 ? world.StateHash(scheduler) : world.StateHash();
+            if (threads == 1) {
+                expected.push_back(hash);
+            } else if (step >= (int)expected.size() || hash != expected[step]) {
+                problem = "state hash differs from serial";
+            }
+        }
+
+        printf("%d threads  ", workers);
+        if (problem) {
+            printf("FAILED at step %d: %s\n", step, problem);
+            failures++;
+        } else {
+            printf("%016llx after %d steps, %lld spawns and %lld despawns dropped\n", (unsigned long long)hash, steps,
+                   world.Pool().DroppedSpawns(), world.Pool().DroppedDespawns());
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+// Pairs of particles closer than their contact distance at the end of a run. Sleeping particles report no
+// contacts, so this is what shows whether a settled pile actually came apart.
+struct OverlapStats {
+    int pairs = 0;
+    double meanShare = 0.0;  // overlap as a share of the contact distance, averaged over the pairs
+    double worstShare = 0.0;
+};
+
+static OverlapStats MeasureOverlap(const World& world) {
+    const ParticleStore& particles = world.Particles();
+    const int count = particles.Size();
+    std::vector<int> order(count);
+    float maxRadius = 0.0f;
+    for (int i = 0; i < count; i++) {
+        order[i] = i;
+        maxRadius = std::max(maxRadius, particles.radius[i]);
+    }
+    std::sort(order.begin(), order.end(), [&](int a, int b) { return particles.x[a] < particles.x[b]; });
+
+    // Sweep along x, nothing further than two of the largest radii away can touch
+    OverlapStats stats;
+    double total = 0.0;
+    for (int k = 0; k < count; k++) {
+        const int a = order[k];
+        for (int m = k + 1; m < count; m++) {
+            const int b = order[m];
+            const float dx = particles.x[b] - particles.x[a];
+            if (dx > 2.0f * maxRadius) break;
+            const float dy = particles.y[b] - particles.y[a];
+            const float contact = particles.radius[a] + particles.radius[b];
+            const float distance = std::sqrt(dx * dx + dy * dy);
+            if (distance >= contact) continue;
+            const double share = (contact - distance) / contact;
+            total += share;
+            stats.worstShare = std::max(stats.worstShare, share);
+            stats.pairs++;
+        }
+    }
+    stats.meanShare = stats.pairs > 0 ? total / stats.pairs : 0.0;
+    return stats;
+}
+
+static void PrintUsage(const char* program) {
+    printf("Usage: %s [options]\n", program);
+    printf("  --scenario NAME   bounce, rain or game (default bounce)\n");
+    printf("  --count N         number of particles (default from the example)\n");
+    printf("  --steps N         number of steps to run (default 1000)\n");
+    printf("  --dt SECONDS      step length (default 1/60)\n");
+    printf("  --width W         world width (default from the example)\n");
+    printf("  --height H        world height (default from the example)\n");
+    printf("  --radius-scale S  multiply the spawned radii by S (default 1)\n");
+    printf("  --seed N          spawn seed (default 1)\n");
+    printf("  --threads N       worker threads, 1 runs serially, 0 uses every core (default 1)\n");
+    printf("  --grain N         particles per scheduler task (default 1024)\n");
+    printf("  --placement NAME  pin workers: none, physical (physical cores first) or numa (one node) (default none)\n");
+    printf("  --reserve N       physical cores to keep free of pinned workers, needs --placement physical or numa\n");
+    printf("  --collisions      enable particle-particle collisions\n");
+    printf("  --emit RATE       add an emitter in the middle releasing RATE particles per second for 1-3 seconds\n");
+    printf("  --capacity N      particles the pool has room for (default count plus what the emitter can keep alive)\n");
+    printf("  --sleep STEPS     steps below the sleep speed before a particle sleeps, 0 never (default 30 for game, else 0)\n");
+    printf("  --xpbd SUBSTEPS   move the game scenario with the position-based solver in this many substeps\n");
+    printf("  --platforms N     scatter N static platforms over the world for the particles to bounce off\n");
+    printf("  --draw-batch      also build the batched draw buffers after every step and time them\n");
+    printf("  --frame-graph     run every step as the phase nodes of a frame graph\n");
+    printf("  --checksums N     print the state hash every N steps and after the last one\n");
+    printf("  --max-awake N     settle check, exit with status 1 if more than N particles are awake after the last step\n");
+    printf("  --churn CHANCE    before every step each particle is despawned with this chance and dropped back in\n");
+    printf("                    from the top, queued on the pool by the workers\n");
+    printf("  --verify-determinism  run the world serially and with several thread counts, grain sizes\n");
+    printf("                    and kernels, compare the state hash after every step and exit\n");
+    printf("  --verify-pool     churn the world with several thread counts, check the handles and compare the state\n");
+    printf("                    hash after every step against a serial run and exit (default churn 0.01)\n");
+    printf("  --trace FILE      write the trace zones as Chrome trace JSON, needs a make TRACE=1 build\n");
+    printf("  --simd ISA        auto, scalar, sse, avx2 or avx512 (default auto)\n");
+    printf("  --verify-kernels  check every SIMD kernel against the scalar one bit for bit and exit\n");
+}
+
+int main(int argc, char** argv) {
+    Scenario scenario = Scenario::Bounce;
+    int count = -1;
+    int steps = 1000;
+    float dt = 1.0f / 60.0f;
+    float width = -1.0f;
+    float height = -1.0f;
+    unsigned int seed = 1;
+    int threads = 1;
+    int grain = DEFAULT_GRAIN_SIZE;
+    KernelIsa simd = KernelIsa::Auto;
+    bool collisions = false;
+    bool drawBatch = false;
+    bool frameGraph = false;
+    bool verifyDeterminism = false;
+    bool verifyPool = false;
+    float churn = 0.0f;
+    int checksumEvery = 0;
+    int maxAwake = -1;
+    const char* tracePath = nullptr;
+    float emitRate = 0.0f;
+    int capacity = 0;
+    int sleepSteps = -1;
+    float radiusScale = 1.0f;
+    int platformCount = 0;
+    int xpbdSubsteps = 0;
+    PlacementPolicy placementPolicy = PlacementPolicy::None;
+    int reservedCores = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+
+        if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0) {
+            PrintUsage(argv[0]);
+            return 0;
+        }
+        if (strcmp(arg, "--verify-kernels") == 0) {
+            return VerifyKernels();
+        }
+        if (strcmp(arg, "--collisions") == 0) {
+            collisions = true;
+            continue;
+        }
+        if (strcmp(arg, "--draw-batch") == 0) {
+            drawBatch = true;
+            continue;
+        }
+        if (strcmp(arg, "--frame-graph") == 0) {
+            frameGraph = true;
+            continue;
+        }
+        if (strcmp(arg, "--verify-determinism") == 0) {
+            verifyDeterminism = true;
+            continue;
+        }
+        if (strcmp(arg, "--verify-pool") == 0) {
+            verifyPool = true;
+            continue;
+        }
+        if (!value) {
+            fprintf(stderr, "Missing value for %s\n", arg);
+            return 1;
+        }
+
+        if (strcmp(arg, "--scenario") == 0) {
+            if (!ParseScenario(value, scenario)) {
+                fprintf(stderr, "Unknown scenario: %s\n", value);
+                return 1;
+            }
+        } else if (strcmp(arg, "--count") == 0) {
+            count = atoi(value);
+        } else if (strcmp(arg, "--steps") == 0) {
+            steps = atoi(value);
+        } else if (strcmp(arg, "--dt") == 0) {
+            dt = (float)atof(value);
+        } else if (strcmp(arg, "--width") == 0) {
+            width = (float)atof(value);
+        } else if (strcmp(arg, "--height") == 0) {
+            height = (float)atof(value);
+        } else if (strcmp(arg, "--radius-scale") == 0) {
+            radiusScale = (float)atof(value);
+        } else if (strcmp(arg, "--seed") == 0) {
+            seed = (unsigned int)strtoul(value, nullptr, 10);
+        } else if (strcmp(arg, "--threads") == 0) {
+            threads = atoi(value);
+        } else if (strcmp(arg, "--grain") == 0) {
+            grain = atoi(value);
+        } else if (strcmp(arg, "--placement") == 0) {
+            if (!ParsePlacementPolicy(value, placementPolicy)) {
+                fprintf(stderr, "Unknown placement: %s\n", value);
+                return 1;
+            }
+        } else if (strcmp(arg, "--reserve") == 0) {
+            reservedCores = atoi(value);
+        } else if (strcmp(arg, "--checksums") == 0) {
+            checksumEvery = atoi(value);
+        } else if (strcmp(arg, "--max-awake") == 0) {
+            maxAwake = atoi(value);
+        } else if (strcmp(arg, "--churn") == 0) {
+            churn = (float)atof(value);
+        } else if (strcmp(arg, "--emit") == 0) {
+            emitRate = (float)atof(value);
+        } else if (strcmp(arg, "--capacity") == 0) {
+            capacity = atoi(value);
+        } else if (strcmp(arg, "--xpbd") == 0) {
+            xpbdSubsteps = atoi(value);
+        } else if (strcmp(arg, "--platforms") == 0) {
+            platformCount = atoi(value);
+        } else if (strcmp(arg, "--sleep") == 0) {
+            sleepSteps = atoi(value);
+        } else if (strcmp(arg, "--trace") == 0) {
+            tracePath = value;
+        } else if (strcmp(arg, "--simd") == 0) {
+            if (!ParseKernelIsa(value, simd)) {
+                fprintf(stderr, "Unknown instruction set: %s\n", value);
+                return 1;
+            }
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", arg);
+            PrintUsage(argv[0]);
+            return 1;
+        }
+        i++;
+    }
+
+    // Unpinned workers can run anywhere, so keeping cores free only means something when the workers are pinned
+    if (reservedCores > 0 && placementPolicy == PlacementPolicy::None) {
+        fprintf(stderr, "--reserve needs --placement physical or numa\n");
+        return 1;
+    }
+
+    WorldConfig config = DefaultConfig(scenario);
+    if (count >= 0) config.particleCount = count;
+    if (width > 0) config.width = width;
+    if (height > 0) config.height = height;
+    config.radiusScale = radiusScale;
+    config.seed = seed;
+    config.grainSize = grain;
+    config.simd = simd;
+    config.collisions = collisions;
+    if (sleepSteps >= 0) config.sleepSteps = std::min(sleepSteps, 65535);
+    if (emitRate > 0.0f) {
+        // Sparks flying out in every direction, living 1 to 3 seconds
+        Emitter emitter;
+        emitter.position = {config.width / 2, config.height / 2};
+        emitter.rate = emitRate;
+        emitter.lifetime = 1.0f;
+        emitter.lifetimeJitter = 2.0f;
+        config.emitters.push_back(emitter);
+    }
+    if (xpbdSubsteps > 0) {
+        config.solver = SolverType::Xpbd;
+        config.substeps = xpbdSubsteps;
+    }
+    config.platforms = RandomPlatforms(platformCount, config.width, config.height, seed);
+    config.capacity = capacity > 0 ? capacity : config.particleCount + (int)(emitRate * 3.0f) + 1;
+
+    if (tracePath && !TraceEnabled()) {
+        fprintf(stderr, "Tracing is compiled out, rebuild with make clean && make TRACE=1\n");
+        return 1;
+    }
+
+    if (verifyDeterminism) {
+        return VerifyDeterminism(config, steps, dt, threads);
+    }
+    if (verifyPool) {
+        return VerifyPool(config, steps, dt, churn > 0.0f ? churn : 0.01f);
+    }
+
+    // The main thread runs as worker 0, so it goes on the first CPU of the placement
+    CpuTopology topology = CpuTopology::Detect();
+    PlacementConfig placementConfig;
+    placementConfig.policy = placementPolicy;
+    placementConfig.threads = threads;
+    placementConfig.reservedCores = reservedCores;
+    WorkerPlacement placement = PlaceWorkers(topology, placementConfig);
+    WorkerPool pool(placement);
+    TaskScheduler scheduler(pool);
+    const int mainCpu = placement.cpus[0] >= 0 && PinCurrentThread(placement.cpus[0]) ? placement.cpus[0] : -1;
+
+    World world = pool.ThreadCount() > 1 ? World(config, scheduler) : World(config);
+
+    // Same buffers the raylib examples upload, rain draws 10 pixel streaks and the rest draw circles
+    DrawBatch batch;
+    const Rgba rainColor = {0, 121, 241, 255};
+    double batchMs = 0.0;
+    double hashMs = 0.0;
+    int hashes = 0;
+    long long updates = 0;
+    TRACE_THREAD_NAME("Main");
+
+    // The phases of the step in a chain, then the snapshot and the draw buffers built from it. The checksum only
+    // reads the world, so it runs on the second lane next to them. Whichever lane runs a phase is worker 0.
+    FrameGraph graph(2, placement.cpus[0]);
+    RenderSnapshot published;
+    bool hashThisStep = false;
+    uint64_t graphHash = 0;
+    if (frameGraph) {
+        int player = graph.AddNode("Player", [&] { world.BeginStep(scheduler); });
+        int integrate = graph.AddNode("Integrate", [&] { world.Integrate(dt, scheduler); });
+        int broadPhase = graph.AddNode("Broad Phase", [&] { world.BroadPhase(scheduler); });
+        int narrowPhase = graph.AddNode("Narrow Phase", [&] { world.NarrowPhase(scheduler); });
+        int endStep = graph.AddNode("End Step", [&] { world.EndStep(dt, scheduler); });
+        int publish = graph.AddNode("Publish", [&] { world.WriteSnapshot(published, scheduler); });
+        int checksum = graph.AddNode("Checksum", [&] {
+            if (!hashThisStep) return;
+            auto hashStart = std::chrono::high_resolution_clock::now();
+            graphHash = world.StateHash();
+            hashMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - hashStart).count();
+        });
+        graph.AddEdge(player, integrate);
+        graph.AddEdge(integrate, broadPhase);
+        graph.AddEdge(broadPhase, narrowPhase);
+        graph.AddEdge(narrowPhase, endStep);
+        graph.AddEdge(endStep, publish);
+        graph.AddEdge(endStep, checksum);
+
+        if (drawBatch) {
+            int renderPrep = graph.AddNode("Render Prep", [&] {
+                auto batchStart = std::chrono::high_resolution_clock::now();
+                if (config.scenario == Scenario::Rain) {
+                    batch.BuildStreaks(MakeDrawSource(published), 10.0f, 1.0f, rainColor, scheduler);
+                } else {
+                    batch.BuildCircles(MakeDrawSource(published), scheduler);
+                }
+                batchMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - batchStart).count();
+            });
+            graph.AddEdge(publish, renderPrep);
+        }
+    }
+
+    // Churn is queued between steps and counts as part of the step it lands in
+    const CounterRandom churnRandom(config.seed);
+    auto startTime = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < steps; i++) {
+        updates += world.ParticleCount();
+        if (churn > 0.0f) QueueChurn(world, &scheduler, churnRandom, churn);
+        const bool hashStep = checksumEvery > 0 && ((i + 1) % checksumEvery == 0 || i + 1 == steps);
+
+        if (frameGraph) {
+            hashThisStep = hashStep;
+            graph.Run();
+            if (hashStep) {
+                hashes++;
+                printf("Step %d: %016llx\n", i + 1, (unsigned long long)graphHash);
+            }
+            continue;
+        }
+
+        if (pool.ThreadCount() > 1) {
+            world.Step(dt, scheduler);
+        } else {
+            world.Step(dt);
+        }
+
+        if (drawBatch) {
+            auto batchStart = std::chrono::high_resolution_clock::now();
+            DrawSource source = MakeDrawSource(world.Particles());
+            if (config.scenario == Scenario::Rain) {
+                if (pool.ThreadCount() > 1) batch.BuildStreaks(source, 10.0f, 1.0f, rainColor, scheduler);
+                else batch.BuildStreaks(source, 10.0f, 1.0f, rainColor);
+            } else {
+                if (pool.ThreadCount() > 1) batch.BuildCircles(source, scheduler);
+                else batch.BuildCircles(source);
+            }
+            batchMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - batchStart).count();
+        }
+
+        if (hashStep) {
+            auto hashStart = std::chrono::high_resolution_clock::now();
+            uint64_t hash = pool.ThreadCount() > 1 ? world.StateHash(scheduler) : world.StateHash();
+            hashMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - hashStart).count();
+            hashes++;
+            printf("Step %d: %016llx\n", i + 1, (unsigned long long)hash);
+        }
+    }
+    auto endTime = std::chrono::high_resolution_clock::now();
+
+    double totalMs = std::chrono::duration<double, std::milli>(endTime - startTime).count() - batchMs - hashMs;
+    double stepMs = steps > 0 ? totalMs / steps : 0.0;
+    double particlesPerSecond = totalMs > 0.0 ? (double)updates / (totalMs / 1000.0) : 0.0;
+
+    printf("Scenario: %s\n", ScenarioName(config.scenario));
+    printf("Particles: %d\n", config.particleCount);
+    printf("Threads: %d\n", pool.ThreadCount());
+    printf("Topology: %d cpus, %d cores, %d %s%s\n", topology.CpuCount(), topology.CoreCount(), topology.NodeCount(),
+           topology.NodeCount() == 1 ? "node" : "nodes", topology.FromSysfs() ? "" : " (sysfs not available)");
+    printf("Placement: %s\n", placement.Describe().c_str());
+    printf("Kernels: %s\n", world.Kernels().name);
+    printf("Steps: %d\n", steps);
+    printf("Total Time: %.3f ms\n", totalMs);
+    printf("Step Time: %.4f ms\n", stepMs);
+    printf("Particle Updates/s: %.3e\n", particlesPerSecond);
+    if (config.collisions) {
+        printf("Contacts (last step): %d\n", world.ContactCount());
+    }
+    if (emitRate > 0.0f) {
+        printf("Live Particles: %d of %d (%lld spawns dropped)\n", world.ParticleCount(), world.Pool().Capacity(), world.Pool().DroppedSpawns());
+    }
+    if (churn > 0.0f) {
+        printf("Churn: %.4f of the particles every step (%lld spawns and %lld despawns dropped)\n", churn,
+               world.Pool().DroppedSpawns(), world.Pool().DroppedDespawns());
+    }
+    if (platformCount > 0) {
+        printf("Platforms: %d (%d tree nodes)\n", world.Level().BoxCount(), world.Level().NodeCount());
+    }
+    if (config.sleepSteps > 0) {
+        printf("Sleeping Particles: %d (%d awake)\n", world.SleepingCount(), world.AwakeCount());
+    }
+    if (config.collisions) {
+        OverlapStats overlap = MeasureOverlap(world);
+        printf("Overlapping Pairs: %d (mean %.1f%%, worst %.1f%% of the contact distance)\n", overlap.pairs,
+               overlap.meanShare * 100.0, overlap.worstShare * 100.0);
+    }
+    if (frameGraph) {
+        printf("Frame Graph: %d nodes on %d lanes\n", graph.NodeCount(), graph.LaneCount());
+    }
+    if (hashes > 0) {
+        printf("Checksum Time: %.4f ms\n", hashMs / hashes);
+    }
+    if (tracePath) {
+        if (!WriteChromeTrace(tracePath)) {
+            fprintf(stderr, "Could not write %s\n", tracePath);
+            return 1;
+        }
+        printf("Trace: %s\n", tracePath);
+    }
+    if (drawBatch) {
+        double batchStepMs = steps > 0 ? batchMs / steps : 0.0;
+        double verticesPerSecond = batchMs > 0.0 ? (double)batch.VertexCount() * steps / (batchMs / 1000.0) : 0.0;
+        printf("Batch Build Time: %.4f ms (%d vertices, %.1f MB)\n", batchStepMs, batch.VertexCount(), batch.ByteSize() / (1024.0 * 1024.0));
+        printf("Batch Vertices/s: %.3e\n", verticesPerSecond);
+    }
+    for (int worker = 0; worker < pool.ThreadCount(); worker++) {
+        WorkerStats stats = pool.Stats(worker);
+        SchedulerStats tasks = scheduler.Stats(worker);
+        char cpu[16] = "unpinned";
+        int pinned = worker == 0 ? mainCpu : pool.Cpu(worker);
+        if (pinned >= 0) snprintf(cpu, sizeof(cpu), "cpu %d", pinned);
+        printf("Worker %d (%s): %lld runs, %.3f ms busy, %lld tasks, %lld steals, %lld idle spins\n",
+               worker, cpu, stats.runs, stats.busyMs, tasks.tasks, tasks.steals, tasks.idleSpins);
+    }
+    if (maxAwake >= 0) {
+        const bool settled = world.AwakeCount() <= maxAwake;
+        printf("Settle Check: %d awake, at most %d allowed, %s\n", world.AwakeCount(), maxAwake, settled ? "passed" : "FAILED");
+        if (!settled) return 1;
+    }
+    return 0;
+}
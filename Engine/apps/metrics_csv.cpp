@@ -0,0 +1,119 @@
+// Converts a binary metrics file written by MetricsLogger into CSV
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "metrics.h"
+
+struct Column {
+    std::string name;
+    MetricsType type;
+    std::vector<unsigned char> values;
+};
+
+static bool ReadHeader(FILE* in, std::vector<Column>& columns) {
+    char magic[8];
+    uint32_t header[2];
+    if (fread(magic, 1, 8, in) != 8 || memcmp(magic, METRICS_MAGIC, 8) != 0) return false;
+    if (fread(header, sizeof(uint32_t), 2, in) != 2) return false;
+
+    columns.resize(header[1]);
+    for (Column& c : columns) {
+        unsigned char type, length;
+        char name[256];
+        if (fread(&type, 1, 1, in) != 1 || fread(&length, 1, 1, in) != 1) return false;
+        if (fread(name, 1, length, in) != length) return false;
+        if (type > (unsigned char)MetricsType::I32) return false;
+        c.name.assign(name, length);
+        c.type = (MetricsType)type;
+    }
+    return true;
+}
+
+static void PrintValue(FILE* out, const Column& c, uint32_t row) {
+    const unsigned char* value = c.values.data() + (size_t)row * MetricsTypeSize(c.type);
+    switch (c.type) {
+    case MetricsType::F64: {
+        double v;
+        memcpy(&v, value, sizeof(v));
+        fprintf(out, "%.6f", v);
+        break;
+    }
+    case MetricsType::F32: {
+        float v;
+        memcpy(&v, value, sizeof(v));
+        fprintf(out, "%.4f", v);
+        break;
+    }
+    case MetricsType::I32: {
+        int32_t v;
+        memcpy(&v, value, sizeof(v));
+        fprintf(out, "%d", v);
+        break;
+    }
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2 || strcmp(argv[1], "--help") == 0 || strcmp(argv[1], "-h") == 0) {
+        printf("Usage: %s INPUT [OUTPUT]\n", argv[0]);
+        printf("  Writes the metrics file INPUT as CSV to OUTPUT, or to stdout without one\n");
+        return argc < 2 ? 1 : 0;
+    }
+
+    FILE* in = fopen(argv[1], "rb");
+    if (!in) {
+        fprintf(stderr, "Could not open %s\n", argv[1]);
+        return 1;
+    }
+
+    std::vector<Column> columns;
+    if (!ReadHeader(in, columns)) {
+        fprintf(stderr, "%s is not a metrics file\n", argv[1]);
+        fclose(in);
+        return 1;
+    }
+
+    FILE* out = argc > 2 ? fopen(argv[2], "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "Could not create %s\n", argv[2]);
+        fclose(in);
+        return 1;
+    }
+
+    for (size_t c = 0; c < columns.size(); c++) {
+        fprintf(out, "%s%s", c > 0 ? "," : "", columns[c].name.c_str());
+    }
+    fprintf(out, "\n");
+
+    // A block cut short by a crash ends the file, every complete block before it is still written out
+    long long rows = 0;
+    uint32_t rowCount;
+    while (fread(&rowCount, sizeof(uint32_t), 1, in) == 1) {
+        bool complete = true;
+        for (Column& c : columns) {
+            size_t size = MetricsTypeSize(c.type);
+            c.values.resize(rowCount * size);
+            if (fread(c.values.data(), size, rowCount, in) != rowCount) complete = false;
+        }
+        if (!complete) {
+            fprintf(stderr, "Truncated block after %lld rows\n", rows);
+            break;
+        }
+
+        for (uint32_t r = 0; r < rowCount; r++) {
+            for (size_t c = 0; c < columns.size(); c++) {
+                if (c > 0) fputc(',', out);
+                PrintValue(out, columns[c], r);
+            }
+            fputc('\n', out);
+        }
+        rows += rowCount;
+    }
+
+    fclose(in);
+    if (out != stdout) fclose(out);
+    return 0;
+}
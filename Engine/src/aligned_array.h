@@ -0,0 +1,82 @@
+// Growable array of trivially copyable values whose storage is aligned to a cache line
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "platform.h"
+
+template <typename T>
+class AlignedArray {
+    static_assert(std::is_trivially_copyable<T>::value, "AlignedArray only holds plain data");
+
+public:
+    AlignedArray() = default;
+    ~AlignedArray() { Free(); }
+
+    AlignedArray(const AlignedArray& other) { *this = other; }
+    AlignedArray& operator=(const AlignedArray& other) {
+        if (this != &other) {
+            Resize(other.count);
+            if (count > 0) memcpy(items, other.items, count * sizeof(T));
+        }
+        return *this;
+    }
+
+    AlignedArray(AlignedArray&& other) noexcept { Swap(other); }
+    AlignedArray& operator=(AlignedArray&& other) noexcept {
+        Swap(other);
+        return *this;
+    }
+
+    T* Data() { return items; }
+    const T* Data() const { return items; }
+    size_t Size() const { return count; }
+    size_t Capacity() const { return capacity; }
+
+    T& operator[](size_t i) { return items[i]; }
+    const T& operator[](size_t i) const { return items[i]; }
+
+    // New elements are left uninitialized
+    void Resize(size_t newCount) {
+        if (newCount > capacity) Reserve(newCount > capacity * 2 ? newCount : capacity * 2);
+        count = newCount;
+    }
+
+    void Reserve(size_t newCapacity) {
+        if (newCapacity <= capacity) return;
+
+        T* newItems = static_cast<T*>(::operator new(newCapacity * sizeof(T), std::align_val_t(CACHE_LINE_SIZE)));
+        if (count > 0) memcpy(newItems, items, count * sizeof(T));
+        Free();
+        items = newItems;
+        capacity = newCapacity;
+    }
+
+    void PushBack(const T& value) {
+        if (count == capacity) Reserve(capacity < 16 ? 16 : capacity * 2);
+        items[count++] = value;
+    }
+
+    void Clear() { count = 0; }
+
+    void Swap(AlignedArray& other) noexcept {
+        std::swap(items, other.items);
+        std::swap(count, other.count);
+        std::swap(capacity, other.capacity);
+    }
+
+private:
+    void Free() {
+        if (items) ::operator delete(items, std::align_val_t(CACHE_LINE_SIZE));
+        items = nullptr;
+        capacity = 0;
+    }
+
+    T* items = nullptr;
+    size_t count = 0;
+    size_t capacity = 0;
+};
@@ -0,0 +1,89 @@
+// GPU side of batched particle drawing, header-only so libphysics.a stays free of raylib. Only the raylib
+// examples include this file.
+#pragma once
+
+#include <cstddef>
+
+#include <raylib.h>
+#include <raymath.h>
+#include <rlgl.h>
+
+#include "draw_batch.h"
+#include "trace.h"
+
+// Uploads a DrawBatch into one dynamic vertex buffer and draws it with raylib's default shader in a single
+// draw call, instead of one DrawCircleV or DrawLineV per particle. Load after InitWindow and Unload before
+// CloseWindow, like any other raylib resource.
+class BatchRenderer {
+public:
+    void Load() {
+        // White disc on a transparent background, streaks sample its center
+        Image image = GenImageColor(kTextureSize, kTextureSize, BLANK);
+        ImageDrawCircle(&image, kTextureSize / 2, kTextureSize / 2, kTextureSize / 2 - 1, WHITE);
+        texture = LoadTextureFromImage(image);
+        SetTextureFilter(texture, TEXTURE_FILTER_BILINEAR);
+        UnloadImage(image);
+
+        vertexArray = rlLoadVertexArray();
+    }
+
+    void Unload() {
+        if (vertexBuffer) rlUnloadVertexBuffer(vertexBuffer);
+        if (vertexArray) rlUnloadVertexArray(vertexArray);
+        UnloadTexture(texture);
+        vertexBuffer = 0;
+        vertexArray = 0;
+        capacity = 0;
+    }
+
+    // Call between BeginDrawing and EndDrawing, draws on top of whatever raylib has queued so far
+    void Draw(const DrawBatch& batch) {
+        TRACE_ZONE("Draw");
+        if (batch.VertexCount() == 0) return;
+
+        // Flush raylib's own batch so earlier draws stay underneath
+        rlDrawRenderBatchActive();
+
+        rlEnableVertexArray(vertexArray);
+        if (batch.VertexCount() > capacity) {
+            // Grow to the next power of two so a slowly growing count does not reallocate every frame
+            while (capacity < batch.VertexCount()) capacity = capacity ? capacity * 2 : 65536;
+            if (vertexBuffer) rlUnloadVertexBuffer(vertexBuffer);
+            vertexBuffer = rlLoadVertexBuffer(nullptr, capacity * (int)sizeof(BatchVertex), true);
+        }
+        rlUpdateVertexBuffer(vertexBuffer, batch.Vertices(), (int)batch.ByteSize(), 0);
+
+        // Attribute pointers are set every draw, platforms without vertex arrays do not remember them
+        int* locs = rlGetShaderLocsDefault();
+        rlEnableVertexBuffer(vertexBuffer);
+        rlSetVertexAttribute(locs[RL_SHADER_LOC_VERTEX_POSITION], 2, RL_FLOAT, false, sizeof(BatchVertex), (void*)offsetof(BatchVertex, x));
+        rlEnableVertexAttribute(locs[RL_SHADER_LOC_VERTEX_POSITION]);
+        rlSetVertexAttribute(locs[RL_SHADER_LOC_VERTEX_TEXCOORD01], 2, RL_FLOAT, false, sizeof(BatchVertex), (void*)offsetof(BatchVertex, u));
+        rlEnableVertexAttribute(locs[RL_SHADER_LOC_VERTEX_TEXCOORD01]);
+        rlSetVertexAttribute(locs[RL_SHADER_LOC_VERTEX_COLOR], 4, RL_UNSIGNED_BYTE, true, sizeof(BatchVertex), (void*)offsetof(BatchVertex, color));
+        rlEnableVertexAttribute(locs[RL_SHADER_LOC_VERTEX_COLOR]);
+
+        rlEnableShader(rlGetShaderIdDefault());
+        Matrix mvp = MatrixMultiply(rlGetMatrixModelview(), rlGetMatrixProjection());
+        rlSetUniformMatrix(locs[RL_SHADER_LOC_MATRIX_MVP], mvp);
+        float diffuse[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+        rlSetUniform(locs[RL_SHADER_LOC_COLOR_DIFFUSE], diffuse, RL_SHADER_UNIFORM_VEC4, 1);
+
+        rlActiveTextureSlot(0);
+        rlEnableTexture(texture.id);
+        rlDrawVertexArray(0, batch.VertexCount());
+
+        rlDisableTexture();
+        rlDisableShader();
+        rlDisableVertexBuffer();
+        rlDisableVertexArray();
+    }
+
+private:
+    static const int kTextureSize = 64;
+
+    Texture2D texture = {};
+    unsigned int vertexArray = 0;
+    unsigned int vertexBuffer = 0;
+    int capacity = 0; // vertices the GPU buffer holds
+};
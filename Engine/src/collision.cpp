@@ -0,0 +1,142 @@
+#include "collision.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "scheduler.h"
+#include "trace.h"
+
+// Share of the overlap pushed apart per step, the rest is left to the velocity response
+static const float kSeparationFactor = 0.8f;
+
+// Ranges of grid slots per scheduler task
+static const int kSolveGrain = 512;
+
+void ContactSolver::Prepare(int count, int workers) {
+    dx.Resize(count);
+    dy.Resize(count);
+    dvx.Resize(count);
+    dvy.Resize(count);
+    // Keep the wake lists' memory between solves
+    if ((int)workerContacts.size() < workers) workerContacts.resize(workers);
+    for (WorkerContacts& worker : workerContacts) {
+        worker.count = 0;
+        worker.woken.Clear();
+    }
+}
+
+// Sum the response of every particle in slots [beginSlot, endSlot) against all of its overlapping neighbours.
+// Reads only the particle store, writes only the sums of the particles it owns and its own wake list.
+int ContactSolver::Gather(const ParticleStore& particles, const SpatialGrid& grid, float restitution, int awake, float wakeSpeed,
+                          int beginSlot, int endSlot, AlignedArray<int>& woken) {
+    TRACE_ZONE("Contact Gather");
+    int pairs = 0;
+
+    for (int slot = beginSlot; slot < endSlot; slot++) {
+        const int a = grid.ParticleAt(slot);
+        if (a >= awake) continue;
+
+        const float ax = particles.x[a];
+        const float ay = particles.y[a];
+        const float avx = particles.vx[a];
+        const float avy = particles.vy[a];
+        const float aRadius = particles.radius[a];
+        const float invMassA = aRadius > 0.0f ? 1.0f / (aRadius * aRadius) : 0.0f;
+        const bool wakes = avx * avx + avy * avy > wakeSpeed * wakeSpeed;
+
+        float sumX = 0.0f;
+        float sumY = 0.0f;
+        float sumVx = 0.0f;
+        float sumVy = 0.0f;
+        int touching = 0;
+
+        grid.ForEachNear(ax, ay, [&](int b) {
+            if (b == a) return;
+
+            float dxAB = particles.x[b] - ax;
+            float dyAB = particles.y[b] - ay;
+            float distanceSquared = dxAB * dxAB + dyAB * dyAB;
+            float reach = aRadius + particles.radius[b];
+            if (distanceSquared >= reach * reach) return;
+
+            touching++;
+            if (b > a) pairs++;
+            if (b >= awake && wakes) woken.PushBack(b);
+
+            float invMassB = particles.radius[b] > 0.0f ? 1.0f / (particles.radius[b] * particles.radius[b]) : 0.0f;
+            float invMassSum = invMassA + invMassB;
+            if (invMassSum <= 0.0f) return;
+
+            // Coincident centers get a fixed normal pointing from the lower index to the higher one, so both
+            // sides of the pair agree on it
+            float distance = std::sqrt(distanceSquared);
+            float nx = a < b ? 1.0f : -1.0f;
+            float ny = 0.0f;
+            if (distance > 0.0f) {
+                nx = dxAB / distance;
+                ny = dyAB / distance;
+            }
+
+            // Our share of the separation, in proportion to inverse mass
+            float correction = (reach - distance) * kSeparationFactor / invMassSum;
+            sumX -= nx * correction * invMassA;
+            sumY -= ny * correction * invMassA;
+
+            // Only approaching pairs exchange momentum
+            float approach = (particles.vx[b] - avx) * nx + (particles.vy[b] - avy) * ny;
+            if (approach >= 0.0f) return;
+
+            float impulse = -(1.0f + restitution) * approach / invMassSum;
+            sumVx -= nx * impulse * invMassA;
+            sumVy -= ny * impulse * invMassA;
+        });
+
+        // Responses to several contacts at once are averaged, each one assumes it is the only contact and
+        // summing them overshoots in dense piles
+        float share = touching > 1 ? 1.0f / (float)touching : 1.0f;
+        dx[a] = sumX * share;
+        dy[a] = sumY * share;
+        dvx[a] = sumVx * share;
+        dvy[a] = sumVy * share;
+    }
+    return pairs;
+}
+
+void ContactSolver::Apply(ParticleStore& particles, int begin, int end) {
+    TRACE_ZONE("Contact Apply");
+    for (int i = begin; i < end; i++) {
+        particles.x[i] += dx[i];
+        particles.y[i] += dy[i];
+        particles.vx[i] += dvx[i];
+        particles.vy[i] += dvy[i];
+    }
+}
+
+void ContactSolver::Solve(ParticleStore& particles, const SpatialGrid& grid, float restitution, int awake, float wakeSpeed) {
+    TRACE_ZONE("Narrow Phase");
+    const int count = particles.Size();
+    Prepare(count, 1);
+    contactCount = Gather(particles, grid, restitution, awake, wakeSpeed, 0, count, workerContacts[0].woken);
+    Apply(particles, 0, awake);
+}
+
+void ContactSolver::Solve(ParticleStore& particles, const SpatialGrid& grid, float restitution, int awake, float wakeSpeed,
+                          TaskScheduler& scheduler) {
+    TRACE_ZONE("Narrow Phase");
+    const int count = particles.Size();
+    Prepare(count, scheduler.WorkerCount());
+
+    // Gather walks the grid slots so neighbouring particles are solved by the same worker
+    scheduler.ParallelFor(0, count, kSolveGrain, [&](int begin, int end, int worker) {
+        WorkerContacts& contacts = workerContacts[worker];
+        contacts.count += Gather(particles, grid, restitution, awake, wakeSpeed, begin, end, contacts.woken);
+    });
+
+    // The barrier between the two passes is what makes this Jacobi: nobody moves until everyone has read
+    scheduler.ParallelFor(0, awake, DEFAULT_GRAIN_SIZE, [&](int begin, int end, int) {
+        Apply(particles, begin, end);
+    });
+
+    contactCount = 0;
+    for (const WorkerContacts& worker : workerContacts) contactCount += worker.count;
+}
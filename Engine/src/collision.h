@@ -0,0 +1,55 @@
+// Particle-particle collisions: uniform grid broad phase, circle narrow phase and impulse response
+#pragma once
+
+#include <vector>
+
+#include "aligned_array.h"
+#include "particles.h"
+#include "platform.h"
+#include "spatial_grid.h"
+
+class TaskScheduler;
+
+// Jacobi contact solver. Every particle gathers the separation and impulse from all of its overlapping
+// neighbours against the state at the start of the solve, then every particle applies its own sum. A particle is
+// only ever written by the range that owns it, so ranges run in parallel without locks or atomics, and the sums
+// are taken in grid order so the result does not depend on the worker count or which worker ran what.
+//
+// Particles at index awake and above are asleep. They stay in the grid so awake particles still land on them,
+// but never look for neighbours and never move. An awake particle faster than wakeSpeed that touches one
+// wakes it, the world applies the wake-ups after the solve.
+class ContactSolver {
+public:
+    // Resolve all overlaps found through the grid, which must have been built from the same positions
+    void Solve(ParticleStore& particles, const SpatialGrid& grid, float restitution, int awake, float wakeSpeed);
+    void Solve(ParticleStore& particles, const SpatialGrid& grid, float restitution, int awake, float wakeSpeed,
+               TaskScheduler& scheduler);
+
+    // Overlapping pairs seen by the last solve, pairs of two sleeping particles are not looked at
+    int ContactCount() const { return contactCount; }
+
+    // Sleeping particles hit by the last solve, in no particular order and possibly more than once
+    int WokenCount(int worker) const { return (int)workerContacts[worker].woken.Size(); }
+    const int* Woken(int worker) const { return workerContacts[worker].woken.Data(); }
+    int WorkerCount() const { return (int)workerContacts.size(); }
+
+private:
+    struct alignas(CACHE_LINE_SIZE) WorkerContacts {
+        int count = 0;
+        AlignedArray<int> woken;
+    };
+
+    void Prepare(int count, int workers);
+    int Gather(const ParticleStore& particles, const SpatialGrid& grid, float restitution, int awake, float wakeSpeed,
+               int beginSlot, int endSlot, AlignedArray<int>& woken);
+    void Apply(ParticleStore& particles, int begin, int end);
+
+    // Per-particle sums, written by the owner during the gather and consumed by the apply
+    AlignedArray<float> dx;
+    AlignedArray<float> dy;
+    AlignedArray<float> dvx;
+    AlignedArray<float> dvy;
+
+    std::vector<WorkerContacts> workerContacts;
+    int contactCount = 0;
+};
@@ -0,0 +1,101 @@
+#include "draw_batch.h"
+
+#include "scheduler.h"
+#include "trace.h"
+#include "world.h"
+
+// Particles per build task, each one writes six vertices
+static const int kBuildGrain = 4096;
+
+DrawSource MakeDrawSource(const ParticleStore& particles) {
+    DrawSource source;
+    source.x = particles.x.Data();
+    source.y = particles.y.Data();
+    source.radius = particles.radius.Data();
+    source.color = particles.color.Data();
+    source.count = particles.Size();
+    return source;
+}
+
+DrawSource MakeDrawSource(const RenderSnapshot& snapshot) {
+    DrawSource source;
+    source.x = snapshot.x.Data();
+    source.y = snapshot.y.Data();
+    source.radius = snapshot.radius.Data();
+    source.color = snapshot.color.Data();
+    source.count = snapshot.Size();
+    return source;
+}
+
+DrawSource MakeDrawSource(const RenderSnapshot& previous, const ParticleStore& particles, float alpha, float snapDistance) {
+    DrawSource source = MakeDrawSource(particles);
+    if (previous.layout == particles.layout && previous.Size() <= particles.Size()) {
+        source.previousX = previous.x.Data();
+        source.previousY = previous.y.Data();
+        source.previousCount = previous.Size();
+        source.alpha = alpha;
+        source.snapDistance = snapDistance;
+    }
+    return source;
+}
+
+// Corners in triangle order: top-left, bottom-left, top-right, top-right, bottom-left, bottom-right
+static inline void WriteQuad(BatchVertex* out, float left, float top, float right, float bottom,
+                             float u0, float v0, float u1, float v1, Rgba color) {
+    out[0] = {left, top, u0, v0, color};
+    out[1] = {left, bottom, u0, v1, color};
+    out[2] = {right, top, u1, v0, color};
+    out[3] = {right, top, u1, v0, color};
+    out[4] = {left, bottom, u0, v1, color};
+    out[5] = {right, bottom, u1, v1, color};
+}
+
+static void CircleRange(const DrawSource& source, BatchVertex* vertices, int begin, int end) {
+    TRACE_ZONE("Batch Range");
+    for (int i = begin; i < end; i++) {
+        const Vec2 p = DrawPosition(source, i);
+        const float r = source.radius[i];
+        WriteQuad(vertices + (size_t)i * DrawBatch::kVerticesPerQuad, p.x - r, p.y - r, p.x + r, p.y + r,
+                  0.0f, 0.0f, 1.0f, 1.0f, source.color[i]);
+    }
+}
+
+static void StreakRange(const DrawSource& source, BatchVertex* vertices, int begin, int end, float length, float width, Rgba color) {
+    TRACE_ZONE("Batch Range");
+    const float half = width * 0.5f;
+    for (int i = begin; i < end; i++) {
+        const Vec2 p = DrawPosition(source, i);
+        WriteQuad(vertices + (size_t)i * DrawBatch::kVerticesPerQuad, p.x - half, p.y, p.x + half, p.y + length,
+                  0.5f, 0.5f, 0.5f, 0.5f, color);
+    }
+}
+
+void DrawBatch::BuildCircles(const DrawSource& source) {
+    TRACE_ZONE("Draw Batch");
+    vertices.Resize((size_t)source.count * kVerticesPerQuad);
+    CircleRange(source, vertices.Data(), 0, source.count);
+}
+
+void DrawBatch::BuildCircles(const DrawSource& source, TaskScheduler& scheduler) {
+    TRACE_ZONE("Draw Batch");
+    vertices.Resize((size_t)source.count * kVerticesPerQuad);
+    BatchVertex* out = vertices.Data();
+    scheduler.ParallelFor(0, source.count, kBuildGrain, [&](int begin, int end, int) {
+        CircleRange(source, out, begin, end);
+    });
+}
+
+void DrawBatch::BuildStreaks(const DrawSource& source, float length, float width, Rgba color) {
+    TRACE_ZONE("Draw Batch");
+    vertices.Resize((size_t)source.count * kVerticesPerQuad);
+    StreakRange(source, vertices.Data(), 0, source.count, length, width, color);
+}
+
+void DrawBatch::BuildStreaks(const DrawSource& source, float length, float width, Rgba color, TaskScheduler& scheduler) {
+    TRACE_ZONE("Draw Batch");
+    vertices.Resize((size_t)source.count * kVerticesPerQuad);
+    BatchVertex* out = vertices.Data();
+    scheduler.ParallelFor(0, source.count, kBuildGrain, [&](int begin, int end, int) {
+        StreakRange(source, out, begin, end, length, width, color);
+    });
+}
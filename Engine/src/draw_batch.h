@@ -0,0 +1,78 @@
+// CPU side of batched particle drawing: one vertex buffer per frame, built in parallel
+#pragma once
+
+#include <cmath>
+
+#include "aligned_array.h"
+#include "particles.h"
+
+class TaskScheduler;
+class ParticleStore;
+struct RenderSnapshot;
+
+// Interleaved vertex, matches raylib's default shader inputs: position, texcoord and normalized color
+struct BatchVertex {
+    float x;
+    float y;
+    float u;
+    float v;
+    Rgba color;
+};
+
+// Arrays a batch is built from, radius and color may be null when the build does not use them. With
+// previousX/previousY set, positions are interpolated between the previous and the current step by alpha.
+struct DrawSource {
+    const float* x;
+    const float* y;
+    const float* radius;
+    const Rgba* color;
+    int count;
+
+    const float* previousX = nullptr;
+    const float* previousY = nullptr;
+    int previousCount = 0; // particles spawned since the previous step are drawn where they are
+    float alpha = 1.0f;
+    float snapDistance = 0.0f; // particles that moved further than this in one step (respawns) are not blended
+};
+
+DrawSource MakeDrawSource(const ParticleStore& particles);
+DrawSource MakeDrawSource(const RenderSnapshot& snapshot);
+
+// Blend from the snapshot taken before the last step to the current particles. Falls back to the current
+// positions when the snapshot does not line up, such as on the first frame or after despawns moved particles.
+// Particles appended since the snapshot are drawn where they are.
+DrawSource MakeDrawSource(const RenderSnapshot& previous, const ParticleStore& particles, float alpha, float snapDistance);
+
+// Position particle i is drawn at, blended when the source has a previous step
+inline Vec2 DrawPosition(const DrawSource& source, int i) {
+    Vec2 position = {source.x[i], source.y[i]};
+    if (!source.previousX || i >= source.previousCount) return position;
+
+    float dx = position.x - source.previousX[i];
+    float dy = position.y - source.previousY[i];
+    if (std::fabs(dx) > source.snapDistance || std::fabs(dy) > source.snapDistance) return position;
+
+    return {source.previousX[i] + dx * source.alpha, source.previousY[i] + dy * source.alpha};
+}
+
+// Two triangles per particle. Circles are quads over a round texture, streaks are thin quads that sample the
+// texture's center, so one texture and one draw call cover both.
+class DrawBatch {
+public:
+    static const int kVerticesPerQuad = 6;
+
+    // One quad of 2 * radius per particle, texcoords span the whole texture
+    void BuildCircles(const DrawSource& source);
+    void BuildCircles(const DrawSource& source, TaskScheduler& scheduler);
+
+    // Vertical streak from each position down by length, width pixels wide, all one color
+    void BuildStreaks(const DrawSource& source, float length, float width, Rgba color);
+    void BuildStreaks(const DrawSource& source, float length, float width, Rgba color, TaskScheduler& scheduler);
+
+    const BatchVertex* Vertices() const { return vertices.Data(); }
+    int VertexCount() const { return (int)vertices.Size(); }
+    size_t ByteSize() const { return vertices.Size() * sizeof(BatchVertex); }
+
+private:
+    AlignedArray<BatchVertex> vertices;
+};
@@ -0,0 +1,28 @@
+#include "emitter.h"
+
+#include <cmath>
+
+int EmitCount(Emitter& emitter, float dt) {
+    int count = emitter.burst;
+    emitter.burst = 0;
+    if (!emitter.active) return count;
+
+    float due = emitter.carry + emitter.rate * dt;
+    int whole = (int)due;
+    emitter.carry = due - (float)whole;
+    return count + whole;
+}
+
+Particle EmitParticle(const Emitter& emitter, const RandomBlock& a, const RandomBlock& b) {
+    float angle = emitter.angleMin + (emitter.angleMax - emitter.angleMin) * RandomUnit(a.word[0]);
+    float speed = emitter.speedMin + (emitter.speedMax - emitter.speedMin) * RandomUnit(a.word[1]);
+
+    Particle p;
+    p.position.x = emitter.position.x + emitter.spread * (RandomUnit(a.word[2]) - 0.5f);
+    p.position.y = emitter.position.y + emitter.spread * (RandomUnit(a.word[3]) - 0.5f);
+    p.velocity = {speed * std::cos(angle), speed * std::sin(angle)};
+    p.radius = emitter.radius;
+    p.color = emitter.color;
+    p.life = emitter.lifetime + emitter.lifetimeJitter * RandomUnit(b.word[0]);
+    return p;
+}
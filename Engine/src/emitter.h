@@ -0,0 +1,32 @@
+// Emitters that spawn short-lived particles at a rate or in bursts
+#pragma once
+
+#include "particles.h"
+#include "random.h"
+
+// Where new particles come from and how they start out. Speed and angle are drawn uniformly from their ranges,
+// lifetime from [lifetime, lifetime + lifetimeJitter]. Angles are in radians, 0 points right and pi/2 down.
+struct Emitter {
+    Vec2 position = {0.0f, 0.0f};
+    float spread = 0.0f;        // particles start anywhere in a square this many pixels wide around position
+    float rate = 0.0f;          // particles per second
+    int burst = 0;              // particles emitted all at once on the next step, then reset to 0
+    float lifetime = 1.0f;
+    float lifetimeJitter = 0.0f;
+    float speedMin = 50.0f;
+    float speedMax = 100.0f;
+    float angleMin = 0.0f;
+    float angleMax = 6.2831853f;
+    float radius = 2.0f;
+    Rgba color = {255, 200, 80, 255};
+    bool active = true;
+
+    // Share of a particle carried over between steps, so low rates still emit on average
+    float carry = 0.0f;
+};
+
+// How many particles the emitter releases over dt seconds, takes the pending burst and updates the carry
+int EmitCount(Emitter& emitter, float dt);
+
+// The particle an emitter releases given two blocks of random words
+Particle EmitParticle(const Emitter& emitter, const RandomBlock& a, const RandomBlock& b);
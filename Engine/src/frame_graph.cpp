@@ -0,0 +1,101 @@
+#include "frame_graph.h"
+
+#include <algorithm>
+
+#include "topology.h"
+#include "trace.h"
+
+FrameGraph::FrameGraph(int laneCount, int cpu) {
+    laneCount = std::max(laneCount, 1);
+    for (int lane = 0; lane < laneCount; lane++) {
+        lanes.emplace_back(&FrameGraph::LaneLoop, this, lane);
+        if (cpu >= 0) PinThread(lanes.back(), cpu);
+    }
+}
+
+FrameGraph::~FrameGraph() {
+    Wait();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    readyCondition.notify_all();
+
+    for (std::thread& lane : lanes) {
+        lane.join();
+    }
+}
+
+void FrameGraph::Clear() {
+    nodes.clear();
+}
+
+int FrameGraph::AddNode(const char* name, std::function<void()> work) {
+    Node node;
+    node.name = name;
+    node.work = std::move(work);
+    nodes.push_back(std::move(node));
+    return (int)nodes.size() - 1;
+}
+
+void FrameGraph::AddEdge(int before, int after) {
+    nodes[before].next.push_back(after);
+    nodes[after].dependencies++;
+}
+
+void FrameGraph::Launch() {
+    if (nodes.empty()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        unfinished = (int)nodes.size();
+        for (int i = 0; i < (int)nodes.size(); i++) {
+            nodes[i].waiting = nodes[i].dependencies;
+            if (nodes[i].dependencies == 0) ready.push_back(i);
+        }
+    }
+    readyCondition.notify_all();
+}
+
+void FrameGraph::Wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    doneCondition.wait(lock, [this] { return unfinished == 0; });
+}
+
+void FrameGraph::Run() {
+    Launch();
+    Wait();
+}
+
+void FrameGraph::LaneLoop(int lane) {
+    TRACE_THREAD_NAME("Frame Graph", lane);
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true) {
+        readyCondition.wait(lock, [this] { return stopping || !ready.empty(); });
+        if (stopping) return;
+
+        // Oldest first, so nodes run in the order they became ready when there are more than lanes
+        const int index = ready.front();
+        ready.erase(ready.begin());
+        Node& node = nodes[index];
+
+        lock.unlock();
+        {
+            TRACE_ZONE(node.name);
+            node.work();
+        }
+        lock.lock();
+
+        // This lane takes the first released node itself, the other lanes are woken for the rest
+        int released = 0;
+        for (int after : node.next) {
+            if (--nodes[after].waiting == 0) {
+                ready.push_back(after);
+                released++;
+            }
+        }
+        if (released > 1) readyCondition.notify_all();
+
+        if (--unfinished == 0) doneCondition.notify_all();
+    }
+}
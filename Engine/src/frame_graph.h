@@ -0,0 +1,70 @@
+// Dependency graph of the coarse jobs in one frame, run in the background while the caller keeps working
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A frame as a DAG of named nodes, such as input -> player -> integrate -> broad phase -> narrow phase -> publish
+// -> render prep. Launch hands the graph to the graph's own threads and returns at once, so the main thread can
+// submit the previous frame's draw calls while this one simulates. Wait blocks until every node has run.
+//
+// A node runs once all of the nodes before it have finished. Ready nodes go to whichever lane is free, so
+// independent nodes run at the same time when there is more than one lane. Nodes are meant to be whole phases
+// that fan out on a TaskScheduler themselves. A WorkerPool runs one job at a time, so two nodes that both use the
+// same scheduler need an edge between them.
+class FrameGraph {
+public:
+    // laneCount threads run the nodes, 1 runs them one at a time in dependency order. A node that runs a WorkerPool
+    // is that pool's worker 0, so cpu pins every lane to the CPU placed for worker 0. -1 leaves the lanes unpinned.
+    explicit FrameGraph(int laneCount = 2, int cpu = -1);
+    ~FrameGraph();
+
+    FrameGraph(const FrameGraph&) = delete;
+    FrameGraph& operator=(const FrameGraph&) = delete;
+
+    // Remove every node, keeping the memory for the next frame's graph. Not while a launch is running.
+    void Clear();
+
+    // Add a node and return its id. Name must outlive the graph, it labels the node's trace zone.
+    int AddNode(const char* name, std::function<void()> work);
+
+    // after only starts once before has finished. The edges must not form a cycle.
+    void AddEdge(int before, int after);
+
+    // Start running every node in the background, the previous launch must have been waited for
+    void Launch();
+
+    // Block until every node of the last launch has run, returns at once when nothing is running
+    void Wait();
+
+    // Launch and Wait, for callers with nothing to overlap
+    void Run();
+
+    int NodeCount() const { return (int)nodes.size(); }
+    int LaneCount() const { return (int)lanes.size(); }
+
+private:
+    struct Node {
+        const char* name;
+        std::function<void()> work;
+        std::vector<int> next;
+        int dependencies = 0; // edges into the node
+        int waiting = 0;      // of those, how many have not finished in this launch
+    };
+
+    void LaneLoop(int lane);
+
+    std::vector<Node> nodes;
+    std::vector<std::thread> lanes;
+
+    // Nodes are a few coarse phases per frame, so one lock around the ready list costs nothing measurable
+    std::mutex mutex;
+    std::condition_variable readyCondition;
+    std::condition_variable doneCondition;
+    std::vector<int> ready;
+    int unfinished = 0;
+    bool stopping = false;
+};
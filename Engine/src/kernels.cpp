@@ -0,0 +1,183 @@
+#include "kernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+// Same test as raylib's CheckCollisionCircleRec
+static bool CircleOverlapsPlayer(float x, float y, float radius, const KernelPlayer& player) {
+    float halfWidth = player.width * 0.5f;
+    float halfHeight = player.height * 0.5f;
+    float dx = std::fabs(x - (player.x + halfWidth));
+    float dy = std::fabs(y - (player.y + halfHeight));
+
+    if (dx > halfWidth + radius || dy > halfHeight + radius) return false;
+    if (dx <= halfWidth || dy <= halfHeight) return true;
+
+    float cornerX = dx - halfWidth;
+    float cornerY = dy - halfHeight;
+    return cornerX * cornerX + cornerY * cornerY <= radius * radius;
+}
+
+static void BounceScalar(const KernelArgs& args, int begin, int end) {
+    float* x = args.x;
+    float* y = args.y;
+    float* vx = args.vx;
+    float* vy = args.vy;
+    const float* radius = args.radius;
+
+    for (int i = begin; i < end; i++) {
+        // Update position
+        x[i] += vx[i] * args.dt;
+        y[i] += vy[i] * args.dt;
+
+        // Bounce off walls
+        if (x[i] <= radius[i] || x[i] >= args.width - radius[i]) {
+            vx[i] = -vx[i];
+        }
+        if (y[i] <= radius[i] || y[i] >= args.height - radius[i]) {
+            vy[i] = -vy[i];
+        }
+    }
+}
+
+static int RainScalar(const KernelArgs& args, int begin, int end, int* respawned) {
+    float* y = args.y;
+    const float* vy = args.vy;
+    int count = 0;
+
+    for (int i = begin; i < end; i++) {
+        y[i] += vy[i] * args.dt;
+        if (y[i] > args.height) {
+            respawned[count++] = i;
+        }
+    }
+    return count;
+}
+
+float GameDrag(float ticks) {
+    return std::pow(GAME_DRAG, ticks);
+}
+
+static void GameScalar(const KernelArgs& args, const KernelPlayer& player, int begin, int end) {
+    float* x = args.x;
+    float* y = args.y;
+    float* vx = args.vx;
+    float* vy = args.vy;
+    const float* radius = args.radius;
+    const float width = args.width;
+    const float height = args.height;
+    const float ticks = args.dt * GAME_TICK_RATE;
+    const float drag = GameDrag(ticks);
+
+    for (int i = begin; i < end; i++) {
+        const float r = radius[i];
+
+        x[i] += vx[i] * ticks;
+        y[i] += vy[i] * ticks;
+
+        if (y[i] + r >= height || y[i] - r <= 0) {
+            vy[i] = -vy[i];
+        }
+        if (x[i] + r >= width || x[i] - r <= 0) {
+            vx[i] = -vx[i];
+        }
+
+        // Gravity, drag and speed cap
+        vy[i] += GAME_GRAVITY * ticks;
+        vx[i] *= drag;
+        vx[i] = std::min(std::max(vx[i], -GAME_SPEED_CAP), GAME_SPEED_CAP);
+        vy[i] = std::min(std::max(vy[i], -GAME_SPEED_CAP), GAME_SPEED_CAP);
+
+        // Player pushes particles in the direction it is moving
+        if (CircleOverlapsPlayer(x[i], y[i], r, player)) {
+            if (player.input < 0) {
+                vx[i] -= player.speed;
+            } else if (player.input > 0) {
+                vx[i] += player.speed;
+            }
+            vy[i] = -vy[i];
+        }
+
+        // Keep within bounds so resting particles sit on the floor
+        x[i] = std::min(std::max(x[i], r), width - r);
+        y[i] = std::min(std::max(y[i], r), height - r);
+    }
+}
+
+const KernelSet& ScalarKernels() {
+    static const KernelSet kernels = {"scalar", KernelIsa::Scalar, BounceScalar, RainScalar, GameScalar};
+    return kernels;
+}
+
+bool CpuSupports(KernelIsa isa) {
+    switch (isa) {
+    case KernelIsa::Auto:
+    case KernelIsa::Scalar:
+        return true;
+#if defined(__x86_64__) || defined(__i386__)
+    case KernelIsa::Sse:
+        return __builtin_cpu_supports("sse2");
+    case KernelIsa::Avx2:
+        return __builtin_cpu_supports("avx2");
+    case KernelIsa::Avx512:
+        return __builtin_cpu_supports("avx512f");
+#else
+    default:
+        return false;
+#endif
+    }
+    return false;
+}
+
+static const KernelSet* KernelsFor(KernelIsa isa) {
+    switch (isa) {
+    case KernelIsa::Scalar: return &ScalarKernels();
+    case KernelIsa::Sse: return SseKernels();
+    case KernelIsa::Avx2: return Avx2Kernels();
+    case KernelIsa::Avx512: return Avx512Kernels();
+    default: return nullptr;
+    }
+}
+
+const KernelSet& SelectKernels(KernelIsa isa) {
+    if (isa == KernelIsa::Auto) {
+        const char* forced = getenv("PHYSICS_SIMD");
+        if (!forced || !ParseKernelIsa(forced, isa)) isa = KernelIsa::Auto;
+    }
+
+    if (isa != KernelIsa::Auto) {
+        const KernelSet* kernels = KernelsFor(isa);
+        if (kernels && CpuSupports(isa)) return *kernels;
+    }
+
+    // Widest first, fall back to scalar
+    const KernelIsa preferred[] = {KernelIsa::Avx512, KernelIsa::Avx2, KernelIsa::Sse};
+    for (KernelIsa candidate : preferred) {
+        const KernelSet* kernels = KernelsFor(candidate);
+        if (kernels && CpuSupports(candidate)) return *kernels;
+    }
+    return ScalarKernels();
+}
+
+bool ParseKernelIsa(const char* name, KernelIsa& isa) {
+    if (strcmp(name, "auto") == 0) isa = KernelIsa::Auto;
+    else if (strcmp(name, "scalar") == 0) isa = KernelIsa::Scalar;
+    else if (strcmp(name, "sse") == 0) isa = KernelIsa::Sse;
+    else if (strcmp(name, "avx2") == 0) isa = KernelIsa::Avx2;
+    else if (strcmp(name, "avx512") == 0) isa = KernelIsa::Avx512;
+    else return false;
+    return true;
+}
+
+const char* KernelIsaName(KernelIsa isa) {
+    switch (isa) {
+    case KernelIsa::Auto: return "auto";
+    case KernelIsa::Scalar: return "scalar";
+    case KernelIsa::Sse: return "sse";
+    case KernelIsa::Avx2: return "avx2";
+    case KernelIsa::Avx512: return "avx512";
+    }
+    return "unknown";
+}
@@ -0,0 +1,70 @@
+// Integrate-and-bounce kernels for each scenario, with SIMD variants picked at runtime
+#pragma once
+
+// Instruction set a kernel set is written for
+enum class KernelIsa {
+    Auto,   // best one the CPU supports
+    Scalar,
+    Sse,    // SSE2
+    Avx2,
+    Avx512  // AVX-512F
+};
+
+// Arrays and bounds the kernels work on, radius is read-only
+struct KernelArgs {
+    float* x;
+    float* y;
+    float* vx;
+    float* vy;
+    const float* radius;
+    float width;
+    float height;
+    float dt;
+};
+
+// Player rectangle the Main Game kernel pushes particles away from
+struct KernelPlayer {
+    float x;
+    float y;
+    float width;
+    float height;
+    float speed;
+    int input; // -1 left, 0 none, 1 right
+};
+
+// Main Game was tuned in pixels per frame at 60 FPS
+#define GAME_TICK_RATE 60.0f
+#define GAME_GRAVITY 0.5f
+#define GAME_DRAG 0.992f
+#define GAME_SPEED_CAP 10.0f
+
+// Share of horizontal velocity kept over a step of this many ticks, GAME_DRAG per tick. Every kernel set takes
+// it from here so they all multiply by the same float.
+float GameDrag(float ticks);
+
+struct KernelSet {
+    const char* name;
+    KernelIsa isa;
+
+    // Particle Example: move, then flip velocity on wall contact
+    void (*bounce)(const KernelArgs& args, int begin, int end);
+
+    // Rain Example: fall, returns how many drops passed the bottom and writes their indices to respawned
+    int (*rain)(const KernelArgs& args, int begin, int end, int* respawned);
+
+    // Main Game: move, bounce, gravity, drag, speed cap, player push and keep within bounds
+    void (*game)(const KernelArgs& args, const KernelPlayer& player, int begin, int end);
+};
+
+// Every variant gives bit-identical results to the scalar kernels
+const KernelSet& ScalarKernels();
+const KernelSet* SseKernels();    // nullptr when not built for x86
+const KernelSet* Avx2Kernels();
+const KernelSet* Avx512Kernels();
+
+// Best kernel set the CPU supports, PHYSICS_SIMD=scalar|sse|avx2|avx512 overrides the choice
+const KernelSet& SelectKernels(KernelIsa isa = KernelIsa::Auto);
+bool CpuSupports(KernelIsa isa);
+
+bool ParseKernelIsa(const char* name, KernelIsa& isa);
+const char* KernelIsaName(KernelIsa isa);
@@ -0,0 +1,144 @@
+// AVX2 kernels, 8 particles per iteration
+#include "kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+#define KERNEL_TARGET __attribute__((target("avx2")))
+
+// Flip the sign of v in the lanes where mask is set, same bits as -v
+KERNEL_TARGET static inline __m256 NegateWhere(__m256 v, __m256 mask) {
+    return _mm256_xor_ps(v, _mm256_and_ps(mask, _mm256_set1_ps(-0.0f)));
+}
+
+KERNEL_TARGET static inline __m256 Le(__m256 a, __m256 b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+KERNEL_TARGET static inline __m256 Ge(__m256 a, __m256 b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+KERNEL_TARGET static inline __m256 Gt(__m256 a, __m256 b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+
+KERNEL_TARGET static void BounceAvx2(const KernelArgs& args, int begin, int end) {
+    const __m256 dt = _mm256_set1_ps(args.dt);
+    const __m256 width = _mm256_set1_ps(args.width);
+    const __m256 height = _mm256_set1_ps(args.height);
+
+    int i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256 x = _mm256_loadu_ps(args.x + i);
+        __m256 y = _mm256_loadu_ps(args.y + i);
+        __m256 vx = _mm256_loadu_ps(args.vx + i);
+        __m256 vy = _mm256_loadu_ps(args.vy + i);
+        __m256 r = _mm256_loadu_ps(args.radius + i);
+
+        x = _mm256_add_ps(x, _mm256_mul_ps(vx, dt));
+        y = _mm256_add_ps(y, _mm256_mul_ps(vy, dt));
+
+        __m256 hitX = _mm256_or_ps(Le(x, r), Ge(x, _mm256_sub_ps(width, r)));
+        __m256 hitY = _mm256_or_ps(Le(y, r), Ge(y, _mm256_sub_ps(height, r)));
+
+        _mm256_storeu_ps(args.x + i, x);
+        _mm256_storeu_ps(args.y + i, y);
+        _mm256_storeu_ps(args.vx + i, NegateWhere(vx, hitX));
+        _mm256_storeu_ps(args.vy + i, NegateWhere(vy, hitY));
+    }
+    ScalarKernels().bounce(args, i, end);
+}
+
+KERNEL_TARGET static int RainAvx2(const KernelArgs& args, int begin, int end, int* respawned) {
+    const __m256 dt = _mm256_set1_ps(args.dt);
+    const __m256 height = _mm256_set1_ps(args.height);
+    int count = 0;
+
+    int i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256 y = _mm256_add_ps(_mm256_loadu_ps(args.y + i), _mm256_mul_ps(_mm256_loadu_ps(args.vy + i), dt));
+        _mm256_storeu_ps(args.y + i, y);
+
+        unsigned int below = (unsigned int)_mm256_movemask_ps(Gt(y, height));
+        while (below) {
+            respawned[count++] = i + __builtin_ctz(below);
+            below &= below - 1;
+        }
+    }
+    return count + ScalarKernels().rain(args, i, end, respawned + count);
+}
+
+KERNEL_TARGET static void GameAvx2(const KernelArgs& args, const KernelPlayer& player, int begin, int end) {
+    const float ticksScalar = args.dt * GAME_TICK_RATE;
+    const float halfWidthScalar = player.width * 0.5f;
+    const float halfHeightScalar = player.height * 0.5f;
+
+    const __m256 ticks = _mm256_set1_ps(ticksScalar);
+    const __m256 width = _mm256_set1_ps(args.width);
+    const __m256 height = _mm256_set1_ps(args.height);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 gravity = _mm256_set1_ps(GAME_GRAVITY * ticksScalar);
+    const __m256 drag = _mm256_set1_ps(GameDrag(ticksScalar));
+    const __m256 cap = _mm256_set1_ps(GAME_SPEED_CAP);
+    const __m256 negCap = _mm256_set1_ps(-GAME_SPEED_CAP);
+    const __m256 signBit = _mm256_set1_ps(-0.0f);
+    const __m256 halfWidth = _mm256_set1_ps(halfWidthScalar);
+    const __m256 halfHeight = _mm256_set1_ps(halfHeightScalar);
+    const __m256 centerX = _mm256_set1_ps(player.x + halfWidthScalar);
+    const __m256 centerY = _mm256_set1_ps(player.y + halfHeightScalar);
+    const __m256 push = _mm256_set1_ps(player.speed);
+
+    int i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256 x = _mm256_loadu_ps(args.x + i);
+        __m256 y = _mm256_loadu_ps(args.y + i);
+        __m256 vx = _mm256_loadu_ps(args.vx + i);
+        __m256 vy = _mm256_loadu_ps(args.vy + i);
+        __m256 r = _mm256_loadu_ps(args.radius + i);
+
+        x = _mm256_add_ps(x, _mm256_mul_ps(vx, ticks));
+        y = _mm256_add_ps(y, _mm256_mul_ps(vy, ticks));
+
+        vy = NegateWhere(vy, _mm256_or_ps(Ge(_mm256_add_ps(y, r), height), Le(_mm256_sub_ps(y, r), zero)));
+        vx = NegateWhere(vx, _mm256_or_ps(Ge(_mm256_add_ps(x, r), width), Le(_mm256_sub_ps(x, r), zero)));
+
+        // Gravity, drag and speed cap, operand order matches std::min/std::max
+        vy = _mm256_add_ps(vy, gravity);
+        vx = _mm256_mul_ps(vx, drag);
+        vx = _mm256_min_ps(cap, _mm256_max_ps(negCap, vx));
+        vy = _mm256_min_ps(cap, _mm256_max_ps(negCap, vy));
+
+        // Circle against player rectangle
+        __m256 dx = _mm256_andnot_ps(signBit, _mm256_sub_ps(x, centerX));
+        __m256 dy = _mm256_andnot_ps(signBit, _mm256_sub_ps(y, centerY));
+        __m256 outside = _mm256_or_ps(Gt(dx, _mm256_add_ps(halfWidth, r)), Gt(dy, _mm256_add_ps(halfHeight, r)));
+        __m256 inside = _mm256_or_ps(Le(dx, halfWidth), Le(dy, halfHeight));
+        __m256 cornerX = _mm256_sub_ps(dx, halfWidth);
+        __m256 cornerY = _mm256_sub_ps(dy, halfHeight);
+        __m256 corner = Le(_mm256_add_ps(_mm256_mul_ps(cornerX, cornerX), _mm256_mul_ps(cornerY, cornerY)), _mm256_mul_ps(r, r));
+        __m256 hit = _mm256_andnot_ps(outside, _mm256_or_ps(inside, corner));
+
+        if (player.input < 0) {
+            vx = _mm256_blendv_ps(vx, _mm256_sub_ps(vx, push), hit);
+        } else if (player.input > 0) {
+            vx = _mm256_blendv_ps(vx, _mm256_add_ps(vx, push), hit);
+        }
+        vy = NegateWhere(vy, hit);
+
+        // Keep within bounds
+        x = _mm256_min_ps(_mm256_sub_ps(width, r), _mm256_max_ps(r, x));
+        y = _mm256_min_ps(_mm256_sub_ps(height, r), _mm256_max_ps(r, y));
+
+        _mm256_storeu_ps(args.x + i, x);
+        _mm256_storeu_ps(args.y + i, y);
+        _mm256_storeu_ps(args.vx + i, vx);
+        _mm256_storeu_ps(args.vy + i, vy);
+    }
+    ScalarKernels().game(args, player, i, end);
+}
+
+const KernelSet* Avx2Kernels() {
+    static const KernelSet kernels = {"avx2", KernelIsa::Avx2, BounceAvx2, RainAvx2, GameAvx2};
+    return &kernels;
+}
+
+#else
+
+const KernelSet* Avx2Kernels() {
+    return nullptr;
+}
+
+#endif
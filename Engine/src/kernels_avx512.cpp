@@ -0,0 +1,157 @@
+// AVX-512F kernels, 16 particles per iteration with masked tails
+#include "kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+// GCC's _mm512_min_ps/_mm512_max_ps start from _mm512_undefined_ps and trip this warning
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+#define KERNEL_TARGET __attribute__((target("avx512f")))
+
+// Flip the sign of v in the lanes where mask is set, same bits as -v
+KERNEL_TARGET static inline __m512 NegateWhere(__m512 v, __mmask16 mask) {
+    __m512i bits = _mm512_castps_si512(v);
+    return _mm512_castsi512_ps(_mm512_mask_xor_epi32(bits, mask, bits, _mm512_set1_epi32((int)0x80000000)));
+}
+
+KERNEL_TARGET static inline __m512 Abs(__m512 v) {
+    return _mm512_castsi512_ps(_mm512_and_epi32(_mm512_castps_si512(v), _mm512_set1_epi32(0x7fffffff)));
+}
+
+KERNEL_TARGET static inline __mmask16 Le(__m512 a, __m512 b) { return _mm512_cmp_ps_mask(a, b, _CMP_LE_OQ); }
+KERNEL_TARGET static inline __mmask16 Ge(__m512 a, __m512 b) { return _mm512_cmp_ps_mask(a, b, _CMP_GE_OQ); }
+KERNEL_TARGET static inline __mmask16 Gt(__m512 a, __m512 b) { return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ); }
+
+// Lanes still inside [i, end)
+static inline __mmask16 LanesLeft(int i, int end) {
+    int left = end - i;
+    return left >= 16 ? (__mmask16)0xFFFF : (__mmask16)((1u << left) - 1);
+}
+
+KERNEL_TARGET static void BounceAvx512(const KernelArgs& args, int begin, int end) {
+    const __m512 dt = _mm512_set1_ps(args.dt);
+    const __m512 width = _mm512_set1_ps(args.width);
+    const __m512 height = _mm512_set1_ps(args.height);
+
+    for (int i = begin; i < end; i += 16) {
+        __mmask16 lanes = LanesLeft(i, end);
+        __m512 x = _mm512_maskz_loadu_ps(lanes, args.x + i);
+        __m512 y = _mm512_maskz_loadu_ps(lanes, args.y + i);
+        __m512 vx = _mm512_maskz_loadu_ps(lanes, args.vx + i);
+        __m512 vy = _mm512_maskz_loadu_ps(lanes, args.vy + i);
+        __m512 r = _mm512_maskz_loadu_ps(lanes, args.radius + i);
+
+        x = _mm512_add_ps(x, _mm512_mul_ps(vx, dt));
+        y = _mm512_add_ps(y, _mm512_mul_ps(vy, dt));
+
+        __mmask16 hitX = Le(x, r) | Ge(x, _mm512_sub_ps(width, r));
+        __mmask16 hitY = Le(y, r) | Ge(y, _mm512_sub_ps(height, r));
+
+        _mm512_mask_storeu_ps(args.x + i, lanes, x);
+        _mm512_mask_storeu_ps(args.y + i, lanes, y);
+        _mm512_mask_storeu_ps(args.vx + i, lanes, NegateWhere(vx, hitX));
+        _mm512_mask_storeu_ps(args.vy + i, lanes, NegateWhere(vy, hitY));
+    }
+}
+
+KERNEL_TARGET static int RainAvx512(const KernelArgs& args, int begin, int end, int* respawned) {
+    const __m512 dt = _mm512_set1_ps(args.dt);
+    const __m512 height = _mm512_set1_ps(args.height);
+    int count = 0;
+
+    for (int i = begin; i < end; i += 16) {
+        __mmask16 lanes = LanesLeft(i, end);
+        __m512 y = _mm512_add_ps(_mm512_maskz_loadu_ps(lanes, args.y + i), _mm512_mul_ps(_mm512_maskz_loadu_ps(lanes, args.vy + i), dt));
+        _mm512_mask_storeu_ps(args.y + i, lanes, y);
+
+        unsigned int below = (unsigned int)(Gt(y, height) & lanes);
+        while (below) {
+            respawned[count++] = i + __builtin_ctz(below);
+            below &= below - 1;
+        }
+    }
+    return count;
+}
+
+KERNEL_TARGET static void GameAvx512(const KernelArgs& args, const KernelPlayer& player, int begin, int end) {
+    const float ticksScalar = args.dt * GAME_TICK_RATE;
+    const float halfWidthScalar = player.width * 0.5f;
+    const float halfHeightScalar = player.height * 0.5f;
+
+    const __m512 ticks = _mm512_set1_ps(ticksScalar);
+    const __m512 width = _mm512_set1_ps(args.width);
+    const __m512 height = _mm512_set1_ps(args.height);
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 gravity = _mm512_set1_ps(GAME_GRAVITY * ticksScalar);
+    const __m512 drag = _mm512_set1_ps(GameDrag(ticksScalar));
+    const __m512 cap = _mm512_set1_ps(GAME_SPEED_CAP);
+    const __m512 negCap = _mm512_set1_ps(-GAME_SPEED_CAP);
+    const __m512 halfWidth = _mm512_set1_ps(halfWidthScalar);
+    const __m512 halfHeight = _mm512_set1_ps(halfHeightScalar);
+    const __m512 centerX = _mm512_set1_ps(player.x + halfWidthScalar);
+    const __m512 centerY = _mm512_set1_ps(player.y + halfHeightScalar);
+    const __m512 push = _mm512_set1_ps(player.speed);
+
+    for (int i = begin; i < end; i += 16) {
+        __mmask16 lanes = LanesLeft(i, end);
+        __m512 x = _mm512_maskz_loadu_ps(lanes, args.x + i);
+        __m512 y = _mm512_maskz_loadu_ps(lanes, args.y + i);
+        __m512 vx = _mm512_maskz_loadu_ps(lanes, args.vx + i);
+        __m512 vy = _mm512_maskz_loadu_ps(lanes, args.vy + i);
+        __m512 r = _mm512_maskz_loadu_ps(lanes, args.radius + i);
+
+        x = _mm512_add_ps(x, _mm512_mul_ps(vx, ticks));
+        y = _mm512_add_ps(y, _mm512_mul_ps(vy, ticks));
+
+        vy = NegateWhere(vy, Ge(_mm512_add_ps(y, r), height) | Le(_mm512_sub_ps(y, r), zero));
+        vx = NegateWhere(vx, Ge(_mm512_add_ps(x, r), width) | Le(_mm512_sub_ps(x, r), zero));
+
+        // Gravity, drag and speed cap, operand order matches std::min/std::max
+        vy = _mm512_add_ps(vy, gravity);
+        vx = _mm512_mul_ps(vx, drag);
+        vx = _mm512_min_ps(cap, _mm512_max_ps(negCap, vx));
+        vy = _mm512_min_ps(cap, _mm512_max_ps(negCap, vy));
+
+        // Circle against player rectangle
+        __m512 dx = Abs(_mm512_sub_ps(x, centerX));
+        __m512 dy = Abs(_mm512_sub_ps(y, centerY));
+        __mmask16 outside = Gt(dx, _mm512_add_ps(halfWidth, r)) | Gt(dy, _mm512_add_ps(halfHeight, r));
+        __mmask16 inside = Le(dx, halfWidth) | Le(dy, halfHeight);
+        __m512 cornerX = _mm512_sub_ps(dx, halfWidth);
+        __m512 cornerY = _mm512_sub_ps(dy, halfHeight);
+        __mmask16 corner = Le(_mm512_add_ps(_mm512_mul_ps(cornerX, cornerX), _mm512_mul_ps(cornerY, cornerY)), _mm512_mul_ps(r, r));
+        __mmask16 hit = (inside | corner) & ~outside;
+
+        if (player.input < 0) {
+            vx = _mm512_mask_sub_ps(vx, hit, vx, push);
+        } else if (player.input > 0) {
+            vx = _mm512_mask_add_ps(vx, hit, vx, push);
+        }
+        vy = NegateWhere(vy, hit);
+
+        // Keep within bounds
+        x = _mm512_min_ps(_mm512_sub_ps(width, r), _mm512_max_ps(r, x));
+        y = _mm512_min_ps(_mm512_sub_ps(height, r), _mm512_max_ps(r, y));
+
+        _mm512_mask_storeu_ps(args.x + i, lanes, x);
+        _mm512_mask_storeu_ps(args.y + i, lanes, y);
+        _mm512_mask_storeu_ps(args.vx + i, lanes, vx);
+        _mm512_mask_storeu_ps(args.vy + i, lanes, vy);
+    }
+}
+
+const KernelSet* Avx512Kernels() {
+    static const KernelSet kernels = {"avx512", KernelIsa::Avx512, BounceAvx512, RainAvx512, GameAvx512};
+    return &kernels;
+}
+
+#else
+
+const KernelSet* Avx512Kernels() {
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,145 @@
+// SSE2 kernels, 4 particles per iteration
+#include "kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+#define KERNEL_TARGET __attribute__((target("sse2")))
+
+// Flip the sign of v in the lanes where mask is set, same bits as -v
+KERNEL_TARGET static inline __m128 NegateWhere(__m128 v, __m128 mask) {
+    return _mm_xor_ps(v, _mm_and_ps(mask, _mm_set1_ps(-0.0f)));
+}
+
+// mask ? a : b
+KERNEL_TARGET static inline __m128 Select(__m128 mask, __m128 a, __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+KERNEL_TARGET static void BounceSse(const KernelArgs& args, int begin, int end) {
+    const __m128 dt = _mm_set1_ps(args.dt);
+    const __m128 width = _mm_set1_ps(args.width);
+    const __m128 height = _mm_set1_ps(args.height);
+
+    int i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m128 x = _mm_loadu_ps(args.x + i);
+        __m128 y = _mm_loadu_ps(args.y + i);
+        __m128 vx = _mm_loadu_ps(args.vx + i);
+        __m128 vy = _mm_loadu_ps(args.vy + i);
+        __m128 r = _mm_loadu_ps(args.radius + i);
+
+        x = _mm_add_ps(x, _mm_mul_ps(vx, dt));
+        y = _mm_add_ps(y, _mm_mul_ps(vy, dt));
+
+        __m128 hitX = _mm_or_ps(_mm_cmple_ps(x, r), _mm_cmpge_ps(x, _mm_sub_ps(width, r)));
+        __m128 hitY = _mm_or_ps(_mm_cmple_ps(y, r), _mm_cmpge_ps(y, _mm_sub_ps(height, r)));
+
+        _mm_storeu_ps(args.x + i, x);
+        _mm_storeu_ps(args.y + i, y);
+        _mm_storeu_ps(args.vx + i, NegateWhere(vx, hitX));
+        _mm_storeu_ps(args.vy + i, NegateWhere(vy, hitY));
+    }
+    ScalarKernels().bounce(args, i, end);
+}
+
+KERNEL_TARGET static int RainSse(const KernelArgs& args, int begin, int end, int* respawned) {
+    const __m128 dt = _mm_set1_ps(args.dt);
+    const __m128 height = _mm_set1_ps(args.height);
+    int count = 0;
+
+    int i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m128 y = _mm_add_ps(_mm_loadu_ps(args.y + i), _mm_mul_ps(_mm_loadu_ps(args.vy + i), dt));
+        _mm_storeu_ps(args.y + i, y);
+
+        unsigned int below = (unsigned int)_mm_movemask_ps(_mm_cmpgt_ps(y, height));
+        while (below) {
+            respawned[count++] = i + __builtin_ctz(below);
+            below &= below - 1;
+        }
+    }
+    return count + ScalarKernels().rain(args, i, end, respawned + count);
+}
+
+KERNEL_TARGET static void GameSse(const KernelArgs& args, const KernelPlayer& player, int begin, int end) {
+    const float ticksScalar = args.dt * GAME_TICK_RATE;
+    const float halfWidthScalar = player.width * 0.5f;
+    const float halfHeightScalar = player.height * 0.5f;
+
+    const __m128 ticks = _mm_set1_ps(ticksScalar);
+    const __m128 width = _mm_set1_ps(args.width);
+    const __m128 height = _mm_set1_ps(args.height);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 gravity = _mm_set1_ps(GAME_GRAVITY * ticksScalar);
+    const __m128 drag = _mm_set1_ps(GameDrag(ticksScalar));
+    const __m128 cap = _mm_set1_ps(GAME_SPEED_CAP);
+    const __m128 negCap = _mm_set1_ps(-GAME_SPEED_CAP);
+    const __m128 signBit = _mm_set1_ps(-0.0f);
+    const __m128 halfWidth = _mm_set1_ps(halfWidthScalar);
+    const __m128 halfHeight = _mm_set1_ps(halfHeightScalar);
+    const __m128 centerX = _mm_set1_ps(player.x + halfWidthScalar);
+    const __m128 centerY = _mm_set1_ps(player.y + halfHeightScalar);
+    const __m128 push = _mm_set1_ps(player.speed);
+
+    int i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m128 x = _mm_loadu_ps(args.x + i);
+        __m128 y = _mm_loadu_ps(args.y + i);
+        __m128 vx = _mm_loadu_ps(args.vx + i);
+        __m128 vy = _mm_loadu_ps(args.vy + i);
+        __m128 r = _mm_loadu_ps(args.radius + i);
+
+        x = _mm_add_ps(x, _mm_mul_ps(vx, ticks));
+        y = _mm_add_ps(y, _mm_mul_ps(vy, ticks));
+
+        vy = NegateWhere(vy, _mm_or_ps(_mm_cmpge_ps(_mm_add_ps(y, r), height), _mm_cmple_ps(_mm_sub_ps(y, r), zero)));
+        vx = NegateWhere(vx, _mm_or_ps(_mm_cmpge_ps(_mm_add_ps(x, r), width), _mm_cmple_ps(_mm_sub_ps(x, r), zero)));
+
+        // Gravity, drag and speed cap, operand order matches std::min/std::max
+        vy = _mm_add_ps(vy, gravity);
+        vx = _mm_mul_ps(vx, drag);
+        vx = _mm_min_ps(cap, _mm_max_ps(negCap, vx));
+        vy = _mm_min_ps(cap, _mm_max_ps(negCap, vy));
+
+        // Circle against player rectangle
+        __m128 dx = _mm_andnot_ps(signBit, _mm_sub_ps(x, centerX));
+        __m128 dy = _mm_andnot_ps(signBit, _mm_sub_ps(y, centerY));
+        __m128 outside = _mm_or_ps(_mm_cmpgt_ps(dx, _mm_add_ps(halfWidth, r)), _mm_cmpgt_ps(dy, _mm_add_ps(halfHeight, r)));
+        __m128 inside = _mm_or_ps(_mm_cmple_ps(dx, halfWidth), _mm_cmple_ps(dy, halfHeight));
+        __m128 cornerX = _mm_sub_ps(dx, halfWidth);
+        __m128 cornerY = _mm_sub_ps(dy, halfHeight);
+        __m128 corner = _mm_cmple_ps(_mm_add_ps(_mm_mul_ps(cornerX, cornerX), _mm_mul_ps(cornerY, cornerY)), _mm_mul_ps(r, r));
+        __m128 hit = _mm_andnot_ps(outside, _mm_or_ps(inside, corner));
+
+        if (player.input < 0) {
+            vx = Select(hit, _mm_sub_ps(vx, push), vx);
+        } else if (player.input > 0) {
+            vx = Select(hit, _mm_add_ps(vx, push), vx);
+        }
+        vy = NegateWhere(vy, hit);
+
+        // Keep within bounds
+        x = _mm_min_ps(_mm_sub_ps(width, r), _mm_max_ps(r, x));
+        y = _mm_min_ps(_mm_sub_ps(height, r), _mm_max_ps(r, y));
+
+        _mm_storeu_ps(args.x + i, x);
+        _mm_storeu_ps(args.y + i, y);
+        _mm_storeu_ps(args.vx + i, vx);
+        _mm_storeu_ps(args.vy + i, vy);
+    }
+    ScalarKernels().game(args, player, i, end);
+}
+
+const KernelSet* SseKernels() {
+    static const KernelSet kernels = {"sse", KernelIsa::Sse, BounceSse, RainSse, GameSse};
+    return &kernels;
+}
+
+#else
+
+const KernelSet* SseKernels() {
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,127 @@
+#include "metrics.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+
+static const uint32_t kMetricsVersion = 1;
+
+// How long the writer sleeps when the queue is empty, short enough that the queue never gets close to full
+static const int kWriterSleepMs = 10;
+
+struct MetricsColumn {
+    const char* name;
+    MetricsType type;
+    size_t offset;
+};
+
+// Schema written into every file header, the converter reads it back from there
+static const MetricsColumn kColumns[] = {
+    {"time_s", MetricsType::F64, offsetof(MetricsSample, time)},
+    {"frame_ms", MetricsType::F32, offsetof(MetricsSample, frameMs)},
+    {"fps", MetricsType::I32, offsetof(MetricsSample, fps)},
+    {"steps", MetricsType::I32, offsetof(MetricsSample, steps)},
+    {"update_ms", MetricsType::F32, offsetof(MetricsSample, updateMs)},
+    {"broad_phase_ms", MetricsType::F32, offsetof(MetricsSample, broadPhaseMs)},
+    {"narrow_phase_ms", MetricsType::F32, offsetof(MetricsSample, narrowPhaseMs)},
+    {"snapshot_ms", MetricsType::F32, offsetof(MetricsSample, snapshotMs)},
+    {"draw_ms", MetricsType::F32, offsetof(MetricsSample, drawMs)},
+    {"particles", MetricsType::I32, offsetof(MetricsSample, particles)},
+    {"threads", MetricsType::I32, offsetof(MetricsSample, threads)},
+};
+
+static const int kColumnCount = sizeof(kColumns) / sizeof(kColumns[0]);
+
+void AddPhaseTimings(MetricsSample& sample, const PhaseTimings& timings) {
+    sample.steps += (int)timings.steps;
+    sample.updateMs += (float)timings.updateMs;
+    sample.broadPhaseMs += (float)timings.broadPhaseMs;
+    sample.narrowPhaseMs += (float)timings.narrowPhaseMs;
+    sample.snapshotMs += (float)timings.snapshotMs;
+}
+
+int MetricsTypeSize(MetricsType type) {
+    switch (type) {
+    case MetricsType::F64: return 8;
+    case MetricsType::F32: return 4;
+    case MetricsType::I32: return 4;
+    }
+    return 0;
+}
+
+bool MetricsLogger::Open(const char* path) {
+    Close();
+
+    file = fopen(path, "wb");
+    if (!file) return false;
+
+    uint32_t header[2] = {kMetricsVersion, (uint32_t)kColumnCount};
+    fwrite(METRICS_MAGIC, 1, 8, file);
+    fwrite(header, sizeof(uint32_t), 2, file);
+    for (const MetricsColumn& c : kColumns) {
+        unsigned char type = (unsigned char)c.type;
+        unsigned char length = (unsigned char)strlen(c.name);
+        fwrite(&type, 1, 1, file);
+        fwrite(&length, 1, 1, file);
+        fwrite(c.name, 1, length, file);
+    }
+
+    fflush(file);
+
+    rows.reserve(METRICS_BLOCK_ROWS);
+    column.resize((size_t)METRICS_BLOCK_ROWS * sizeof(double));
+    stopping.store(false, std::memory_order_relaxed);
+    dropped.store(0, std::memory_order_relaxed);
+    writer = std::thread(&MetricsLogger::WriterLoop, this);
+    return true;
+}
+
+void MetricsLogger::Log(const MetricsSample& sample) {
+    if (!queue.TryPush(sample)) dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+void MetricsLogger::Close() {
+    if (!writer.joinable()) return;
+
+    stopping.store(true, std::memory_order_release);
+    writer.join();
+    fclose(file);
+    file = nullptr;
+}
+
+void MetricsLogger::WriterLoop() {
+    MetricsSample sample;
+    while (true) {
+        // Read before draining so nothing logged before Close is left behind
+        bool stop = stopping.load(std::memory_order_acquire);
+
+        bool popped = false;
+        while (queue.TryPop(sample)) {
+            popped = true;
+            rows.push_back(sample);
+            if ((int)rows.size() == METRICS_BLOCK_ROWS) WriteBlock();
+        }
+
+        if (stop) break;
+        if (!popped) std::this_thread::sleep_for(std::chrono::milliseconds(kWriterSleepMs));
+    }
+    WriteBlock();
+}
+
+// Transpose the buffered rows into one run of values per column. Flushed right away, so the block is in the file
+// even if the program dies before Close.
+void MetricsLogger::WriteBlock() {
+    if (rows.empty()) return;
+
+    uint32_t rowCount = (uint32_t)rows.size();
+    fwrite(&rowCount, sizeof(uint32_t), 1, file);
+    for (const MetricsColumn& c : kColumns) {
+        const int size = MetricsTypeSize(c.type);
+        for (uint32_t r = 0; r < rowCount; r++) {
+            memcpy(&column[(size_t)r * size], (const unsigned char*)&rows[r] + c.offset, size);
+        }
+        fwrite(column.data(), size, rowCount, file);
+    }
+    fflush(file);
+    rows.clear();
+}
@@ -0,0 +1,87 @@
+// Per-frame metrics queued from the render loop and written to a binary columnar file on a background thread
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "spsc_queue.h"
+#include "world.h"
+
+// Samples the queue holds before the writer catches up, about a minute of frames at 1000 fps
+#define METRICS_QUEUE_CAPACITY 65536
+
+// Rows per block of columns in the file, also how many rows the writer keeps in memory
+#define METRICS_BLOCK_ROWS 4096
+
+// First eight bytes of every metrics file
+#define METRICS_MAGIC "PHYSMET1"
+
+// One row per frame, times are in milliseconds and phases that did not run stay 0
+struct MetricsSample {
+    double time = 0.0; // seconds since the run started
+    float frameMs = 0.0f;
+    int fps = 0;
+    int steps = 0; // physics steps run this frame
+    float updateMs = 0.0f;
+    float broadPhaseMs = 0.0f;
+    float narrowPhaseMs = 0.0f;
+    float snapshotMs = 0.0f;
+    float drawMs = 0.0f;
+    int particles = 0;
+    int threads = 0;
+};
+
+// Add the physics phases from a world's timings to a sample
+void AddPhaseTimings(MetricsSample& sample, const PhaseTimings& timings);
+
+// Value types a column can hold
+enum class MetricsType : uint8_t {
+    F64 = 0,
+    F32 = 1,
+    I32 = 2
+};
+
+int MetricsTypeSize(MetricsType type);
+
+// File layout, all values little-endian:
+//   header  "PHYSMET1", u32 version, u32 column count, then per column u8 type, u8 name length, name bytes
+//   blocks  until the end of the file: u32 row count, then every column's values for those rows back to back
+// Every block is flushed once written, so a program that dies before Close keeps every full block it logged and
+// only loses the rows still buffered for the next one.
+class MetricsLogger {
+public:
+    MetricsLogger() : queue(METRICS_QUEUE_CAPACITY) {}
+    ~MetricsLogger() { Close(); }
+
+    MetricsLogger(const MetricsLogger&) = delete;
+    MetricsLogger& operator=(const MetricsLogger&) = delete;
+
+    // Create the file, write the header and start the writer thread. Returns false if the file cannot be created.
+    bool Open(const char* path);
+
+    // Queue a sample from the thread that owns the logger. Never blocks or allocates, if the writer has fallen
+    // a whole queue behind the sample is dropped and counted instead.
+    void Log(const MetricsSample& sample);
+
+    // Write everything still queued, close the file and stop the writer thread
+    void Close();
+
+    long long Dropped() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    void WriterLoop();
+    void WriteBlock();
+
+    SpscQueue<MetricsSample> queue;
+    std::thread writer;
+    std::atomic<bool> stopping{false};
+    std::atomic<long long> dropped{0};
+
+    // Only touched by the writer thread while it runs
+    FILE* file = nullptr;
+    std::vector<MetricsSample> rows;
+    std::vector<unsigned char> column;
+};
@@ -0,0 +1,295 @@
+#include "particle_pool.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "scheduler.h"
+
+// Particles per compaction block, fixed so the layout does not depend on the worker count
+static const int kCompactBlock = 16384;
+
+// Queue entries every worker has room for on top of its even share of the capacity, work stealing rarely hands
+// one worker exactly its share
+static const int kQueueSlack = 1024;
+
+void ParticlePool::Reset(ParticleStore& particles, int count, int capacity) {
+    if (capacity < count) capacity = count;
+
+    particles.Reserve(capacity);
+    particles.Resize(count);
+    particles.layout++;
+
+    slotIndex.Resize(capacity);
+    generations.Resize(capacity);
+    indexSlot.Reserve(capacity);
+    indexSlot.Resize(count);
+    freeSlots.Reserve(capacity);
+    freeSlots.Resize(capacity - count);
+    compacted.Reserve(capacity);
+    compactedSlot.Reserve(capacity);
+
+    // The first particles take the first slots, the free list hands out the rest in ascending order
+    for (int i = 0; i < capacity; i++) {
+        slotIndex[i] = i < count ? i : -1;
+        generations[i] = 0;
+    }
+    for (int i = 0; i < count; i++) indexSlot[i] = i;
+    for (int i = 0; i < capacity - count; i++) freeSlots[i] = capacity - 1 - i;
+
+    for (WorkerQueue& queue : queues) {
+        queue.spawns.Clear();
+        queue.despawns.Clear();
+        queue.droppedSpawns = 0;
+        queue.droppedDespawns = 0;
+    }
+    ReserveQueues();
+    droppedSpawns = 0;
+    droppedDespawns = 0;
+    mortal = false;
+}
+
+ParticleHandle ParticlePool::Spawn(ParticleStore& particles, const Particle& p) {
+    if (freeSlots.Size() == 0) return ParticleHandle();
+
+    int slot = freeSlots[freeSlots.Size() - 1];
+    freeSlots.Resize(freeSlots.Size() - 1);
+
+    int index = particles.Add(p);
+    mortal = mortal || !std::isinf(p.life);
+    slotIndex[slot] = index;
+    indexSlot.PushBack(slot);
+    return {(uint32_t)slot, generations[slot]};
+}
+
+int ParticlePool::SpawnBlock(ParticleStore& particles, int count, int& first) {
+    count = std::min(count, (int)freeSlots.Size());
+    mortal = true;
+    first = particles.Size();
+    particles.Resize(first + count);
+    indexSlot.Resize(first + count);
+
+    for (int k = 0; k < count; k++) {
+        int slot = freeSlots[freeSlots.Size() - 1 - k];
+        slotIndex[slot] = first + k;
+        indexSlot[first + k] = slot;
+    }
+    freeSlots.Resize(freeSlots.Size() - count);
+    return count;
+}
+
+bool ParticlePool::Despawn(ParticleStore& particles, ParticleHandle handle) {
+    int index = IndexOf(handle);
+    if (index < 0) return false;
+    RemoveAt(particles, index);
+    return true;
+}
+
+// Move the last particle into the hole so the store stays packed
+void ParticlePool::RemoveAt(ParticleStore& particles, int index) {
+    const int last = particles.Size() - 1;
+    const int slot = indexSlot[index];
+
+    if (index != last) {
+        particles.Set(index, particles.Get(last));
+        indexSlot[index] = indexSlot[last];
+        slotIndex[indexSlot[index]] = index;
+    }
+    particles.Resize(last);
+    particles.layout++;
+    indexSlot.Resize(last);
+
+    slotIndex[slot] = -1;
+    generations[slot]++;
+    freeSlots.PushBack(slot);
+}
+
+void ParticlePool::SwapIndices(ParticleStore& particles, int a, int b) {
+    if (a == b) return;
+
+    Particle p = particles.Get(a);
+    particles.Set(a, particles.Get(b));
+    particles.Set(b, p);
+    particles.layout++;
+
+    std::swap(indexSlot[a], indexSlot[b]);
+    slotIndex[indexSlot[a]] = a;
+    slotIndex[indexSlot[b]] = b;
+}
+
+int ParticlePool::CountBlock(const ParticleStore& particles, int block) const {
+    const int end = std::min((block + 1) * kCompactBlock, particles.Size());
+    int alive = 0;
+    for (int i = block * kCompactBlock; i < end; i++) alive += particles.life[i] > 0.0f;
+    return alive;
+}
+
+// Survivors go to the block's output offset in order, the dead free their slots at the block's rank among the
+// dead. Every block writes disjoint output indices, free list entries and slots.
+void ParticlePool::CompactBlock(const ParticleStore& particles, int block) {
+    const int begin = block * kCompactBlock;
+    const int end = std::min(begin + kCompactBlock, particles.Size());
+    int out = blockAlive[block];
+    int freed = freeBase + (begin - blockAlive[block]);
+
+    for (int i = begin; i < end; i++) {
+        const int slot = indexSlot[i];
+        if (particles.life[i] > 0.0f) {
+            compacted.x[out] = particles.x[i];
+            compacted.y[out] = particles.y[i];
+            compacted.vx[out] = particles.vx[i];
+            compacted.vy[out] = particles.vy[i];
+            compacted.radius[out] = particles.radius[i];
+            compacted.color[out] = particles.color[i];
+            compacted.life[out] = particles.life[i];
+            compacted.still[out] = particles.still[i];
+            compactedSlot[out] = slot;
+            slotIndex[slot] = out;
+            out++;
+        } else {
+            slotIndex[slot] = -1;
+            generations[slot]++;
+            freeSlots[freed++] = slot;
+        }
+    }
+}
+
+int ParticlePool::RemoveDead(ParticleStore& particles) {
+    const int blocks = (particles.Size() + kCompactBlock - 1) / kCompactBlock;
+    blockAlive.Resize(blocks);
+    for (int b = 0; b < blocks; b++) blockAlive[b] = CountBlock(particles, b);
+    if (PrepareCompact(particles.Size(), blocks) == 0) return 0;
+
+    for (int b = 0; b < blocks; b++) CompactBlock(particles, b);
+    return SwapCompacted(particles);
+}
+
+int ParticlePool::RemoveDead(ParticleStore& particles, TaskScheduler& scheduler) {
+    const int blocks = (particles.Size() + kCompactBlock - 1) / kCompactBlock;
+    blockAlive.Resize(blocks);
+    scheduler.ParallelFor(0, blocks, 1, [&](int begin, int end, int) {
+        for (int b = begin; b < end; b++) blockAlive[b] = CountBlock(particles, b);
+    });
+    if (PrepareCompact(particles.Size(), blocks) == 0) return 0;
+
+    scheduler.ParallelFor(0, blocks, 1, [&](int begin, int end, int) {
+        for (int b = begin; b < end; b++) CompactBlock(particles, b);
+    });
+    return SwapCompacted(particles);
+}
+
+// Scan the survivor counts into output offsets and size the output, returns how many particles died
+int ParticlePool::PrepareCompact(int count, int blocks) {
+    int running = 0;
+    for (int b = 0; b < blocks; b++) {
+        int alive = blockAlive[b];
+        blockAlive[b] = running;
+        running += alive;
+    }
+    survivors = running;
+    if (survivors == count) return 0;
+
+    compacted.Resize(survivors);
+    compactedSlot.Resize(survivors);
+    freeBase = (int)freeSlots.Size();
+    freeSlots.Resize(freeBase + (count - survivors));
+    return count - survivors;
+}
+
+int ParticlePool::SwapCompacted(ParticleStore& particles) {
+    int removed = particles.Size() - survivors;
+    particles.Swap(compacted);
+    particles.layout++;
+    indexSlot.Swap(compactedSlot);
+    return removed;
+}
+
+int ParticlePool::IndexOf(ParticleHandle handle) const {
+    if (handle.slot >= generations.Size() || generations[handle.slot] != handle.generation) return -1;
+    return slotIndex[handle.slot];
+}
+
+ParticleHandle ParticlePool::HandleOf(int index) const {
+    int slot = indexSlot[index];
+    return {(uint32_t)slot, generations[slot]};
+}
+
+void ParticlePool::ReserveWorkers(int workers) {
+    if ((int)queues.size() >= workers) return;
+    queues.resize(workers);
+    ReserveQueues();
+}
+
+// Room for every queue, and for the merged queues to take all of them at once
+void ParticlePool::ReserveQueues() {
+    if (queues.empty()) return;
+    const size_t room = Capacity() / queues.size() + kQueueSlack;
+    size_t spawns = 0;
+    size_t despawns = 0;
+    for (WorkerQueue& queue : queues) {
+        queue.spawns.Reserve(room);
+        queue.despawns.Reserve(room);
+        spawns += queue.spawns.Capacity();
+        despawns += queue.despawns.Capacity();
+    }
+    mergedSpawns.Reserve(spawns);
+    mergedDespawns.Reserve(despawns);
+}
+
+void ParticlePool::QueueSpawn(int worker, uint64_t order, const Particle& p) {
+    WorkerQueue& queue = queues[worker];
+    if (queue.spawns.Size() == queue.spawns.Capacity()) {
+        queue.droppedSpawns++;
+        return;
+    }
+    queue.spawns.PushBack({order, p});
+}
+
+void ParticlePool::QueueDespawn(int worker, ParticleHandle handle) {
+    WorkerQueue& queue = queues[worker];
+    if (queue.despawns.Size() == queue.despawns.Capacity()) {
+        queue.droppedDespawns++;
+        return;
+    }
+    queue.despawns.PushBack(handle);
+}
+
+int ParticlePool::Flush(ParticleStore& particles) {
+    // Despawn from the highest index down. The particle moved into each hole then always comes from above every
+    // pending index, so the pending indices stay valid and the layout does not depend on the queueing order.
+    mergedDespawns.Clear();
+    for (WorkerQueue& queue : queues) {
+        for (size_t i = 0; i < queue.despawns.Size(); i++) {
+            int index = IndexOf(queue.despawns[i]);
+            if (index >= 0) mergedDespawns.PushBack(index);
+        }
+        queue.despawns.Clear();
+        droppedDespawns += queue.droppedDespawns;
+        queue.droppedDespawns = 0;
+    }
+    int* despawnBegin = mergedDespawns.Data();
+    int* despawnEnd = despawnBegin + mergedDespawns.Size();
+    std::sort(despawnBegin, despawnEnd, [](int a, int b) { return a > b; });
+    despawnEnd = std::unique(despawnBegin, despawnEnd);
+    for (int* index = despawnBegin; index != despawnEnd; index++) RemoveAt(particles, *index);
+
+    // Spawns land in order, whichever worker queued them
+    mergedSpawns.Clear();
+    for (WorkerQueue& queue : queues) {
+        for (size_t i = 0; i < queue.spawns.Size(); i++) mergedSpawns.PushBack(queue.spawns[i]);
+        queue.spawns.Clear();
+        droppedSpawns += queue.droppedSpawns;
+        queue.droppedSpawns = 0;
+    }
+    std::sort(mergedSpawns.Data(), mergedSpawns.Data() + mergedSpawns.Size(),
+              [](const QueuedSpawn& a, const QueuedSpawn& b) { return a.order < b.order; });
+
+    int spawned = 0;
+    for (size_t i = 0; i < mergedSpawns.Size(); i++) {
+        if (!Spawn(particles, mergedSpawns[i].particle).Valid()) {
+            droppedSpawns += (long long)(mergedSpawns.Size() - i);
+            break;
+        }
+        spawned++;
+    }
+    return spawned;
+}
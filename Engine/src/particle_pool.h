@@ -0,0 +1,125 @@
+// Stable handles, O(1) spawn/despawn and per-worker spawn queues over a dense ParticleStore
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "aligned_array.h"
+#include "particles.h"
+#include "platform.h"
+
+class TaskScheduler;
+
+// Refers to one particle for as long as it lives, even while despawns move other particles around the store.
+// A handle whose particle was despawned is stale: its generation no longer matches the slot's.
+struct ParticleHandle {
+    uint32_t slot = UINT32_MAX;
+    uint32_t generation = 0;
+
+    bool Valid() const { return slot != UINT32_MAX; }
+};
+
+// Keeps the particles of a ParticleStore packed at indices [0, Size()) so the update loops stay contiguous.
+// Despawning moves the last particle into the hole. Handles go through a slot table that follows those moves,
+// with a free list of unused slots. Reset reserves room for the capacity up front, and ReserveWorkers does the same
+// for the queues, so spawning, despawning and queueing never allocate. A spawn past the capacity fails instead.
+class ParticlePool {
+public:
+    // Forget every handle, resize the store to count particles and give each of them a fresh handle
+    void Reset(ParticleStore& particles, int count, int capacity);
+
+    int Capacity() const { return (int)generations.Size(); }
+
+    // Append a particle, returns an invalid handle when the pool is full
+    ParticleHandle Spawn(ParticleStore& particles, const Particle& p);
+
+    // Append count particles at once, at most as many as still fit, and return the index of the first. The caller
+    // fills indices [first, first + returned count) afterwards, from as many threads as it likes.
+    int SpawnBlock(ParticleStore& particles, int count, int& first);
+
+    // Remove a particle, returns false if the handle is stale
+    bool Despawn(ParticleStore& particles, ParticleHandle handle);
+
+    // Remove every particle whose life has run out and pack the survivors down, keeping their order. Fixed-size
+    // blocks count their survivors, a prefix sum over the counts gives every block its output offset, and every
+    // block then copies its survivors into a second store, which is swapped in. The scheduler runs the blocks in
+    // parallel with the same result. Returns the number of particles removed.
+    int RemoveDead(ParticleStore& particles);
+    int RemoveDead(ParticleStore& particles, TaskScheduler& scheduler);
+
+    // Exchange the particles at two indices, their handles follow them
+    void SwapIndices(ParticleStore& particles, int a, int b);
+
+    bool Alive(ParticleHandle handle) const { return IndexOf(handle) >= 0; }
+
+    // Current index in the store, -1 for a stale handle
+    int IndexOf(ParticleHandle handle) const;
+
+    // Handle of the particle at an index in the store
+    ParticleHandle HandleOf(int index) const;
+
+    // Make sure workers [0, workers) each have a queue, queued entries are kept. Every queue has room for an even
+    // share of the capacity plus some slack.
+    void ReserveWorkers(int workers);
+
+    // Queue a spawn or despawn from inside a parallel loop. Each worker only touches its own queue, so this takes
+    // no lock. A worker whose queue is full drops the entry and counts it instead of growing the queue. Which
+    // entries drop depends on the worker that queued them, so only a run that drops nothing is the same for every
+    // thread count. Order decides where queued spawns land and must be unique per flush, e.g. derived from the
+    // index of the particle that caused the spawn.
+    void QueueSpawn(int worker, uint64_t order, const Particle& p);
+    void QueueDespawn(int worker, ParticleHandle handle);
+
+    // Apply every queued despawn and then every queued spawn, called at the frame barrier once no worker is
+    // queueing. The result only depends on the queued handles and orders, not on which worker queued them.
+    // Returns the number of particles spawned.
+    int Flush(ParticleStore& particles);
+
+    // Queued spawns that did not fit in their queue or the pool, and queued despawns that did not fit in their
+    // queue, since the last Reset. Entries dropped by a queue are counted at the next Flush.
+    long long DroppedSpawns() const { return droppedSpawns; }
+    long long DroppedDespawns() const { return droppedDespawns; }
+
+    // True once a particle with a finite life, or a block, was spawned since the last Reset. Until then nothing
+    // can die and the world skips aging and RemoveDead.
+    bool HasMortal() const { return mortal; }
+
+private:
+    struct QueuedSpawn {
+        uint64_t order;
+        Particle particle;
+    };
+
+    // Padded so two workers queueing at once never share a cache line
+    struct alignas(CACHE_LINE_SIZE) WorkerQueue {
+        AlignedArray<QueuedSpawn> spawns;
+        AlignedArray<ParticleHandle> despawns;
+        long long droppedSpawns = 0;
+        long long droppedDespawns = 0;
+    };
+
+    void ReserveQueues();
+    void RemoveAt(ParticleStore& particles, int index);
+    int CountBlock(const ParticleStore& particles, int block) const;
+    void CompactBlock(const ParticleStore& particles, int block);
+    int PrepareCompact(int count, int blocks);
+    int SwapCompacted(ParticleStore& particles);
+
+    AlignedArray<int> slotIndex;         // store index of each live slot
+    AlignedArray<uint32_t> generations;  // bumped every time a slot's particle is despawned
+    AlignedArray<int> indexSlot;         // slot of each store index
+    AlignedArray<int> freeSlots;         // stack of unused slots
+    std::vector<WorkerQueue> queues;
+    AlignedArray<QueuedSpawn> mergedSpawns;
+    AlignedArray<int> mergedDespawns;
+
+    // Compaction state: survivors per block turned into output offsets, and the store the survivors go to
+    AlignedArray<int> blockAlive;
+    int freeBase = 0;
+    int survivors = 0;
+    ParticleStore compacted;
+    AlignedArray<int> compactedSlot;
+    long long droppedSpawns = 0;
+    long long droppedDespawns = 0;
+    bool mortal = false;
+};
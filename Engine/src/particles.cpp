@@ -0,0 +1,72 @@
+#include "particles.h"
+
+#include <algorithm>
+#include <cstring>
+
+template <typename T>
+static void TouchArray(AlignedArray<T>& array, int begin, int end) {
+    end = std::min(end, (int)array.Capacity());
+    if (begin < end) memset(array.Data() + begin, 0, (size_t)(end - begin) * sizeof(T));
+}
+
+void ParticleStore::Resize(int count) {
+    x.Resize(count);
+    y.Resize(count);
+    vx.Resize(count);
+    vy.Resize(count);
+    radius.Resize(count);
+    color.Resize(count);
+    life.Resize(count);
+    still.Resize(count);
+}
+
+void ParticleStore::Reserve(int count) {
+    x.Reserve(count);
+    y.Reserve(count);
+    vx.Reserve(count);
+    vy.Reserve(count);
+    radius.Reserve(count);
+    color.Reserve(count);
+    life.Reserve(count);
+    still.Reserve(count);
+}
+
+void ParticleStore::Touch(int begin, int end) {
+    TouchArray(x, begin, end);
+    TouchArray(y, begin, end);
+    TouchArray(vx, begin, end);
+    TouchArray(vy, begin, end);
+    TouchArray(radius, begin, end);
+    TouchArray(color, begin, end);
+    TouchArray(life, begin, end);
+    TouchArray(still, begin, end);
+}
+
+int ParticleStore::Add(const Particle& p) {
+    int index = Size();
+    Resize(index + 1);
+    Set(index, p);
+    return index;
+}
+
+void ParticleStore::Set(int i, const Particle& p) {
+    x[i] = p.position.x;
+    y[i] = p.position.y;
+    vx[i] = p.velocity.x;
+    vy[i] = p.velocity.y;
+    radius[i] = p.radius;
+    color[i] = p.color;
+    life[i] = p.life;
+    still[i] = p.still;
+}
+
+void ParticleStore::Swap(ParticleStore& other) {
+    x.Swap(other.x);
+    y.Swap(other.y);
+    vx.Swap(other.vx);
+    vy.Swap(other.vy);
+    radius.Swap(other.radius);
+    color.Swap(other.color);
+    life.Swap(other.life);
+    still.Swap(other.still);
+}
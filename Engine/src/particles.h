@@ -0,0 +1,91 @@
+// Particle data shared by every simulation in the engine
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+
+#include "aligned_array.h"
+
+// Plain 2D vector, layout compatible with raylib's Vector2
+struct Vec2 {
+    float x;
+    float y;
+};
+
+// 8-bit RGBA color, layout compatible with raylib's Color
+struct Rgba {
+    unsigned char r;
+    unsigned char g;
+    unsigned char b;
+    unsigned char a;
+};
+
+// Single particle position, velocity, radius, color, seconds left to live and how long it has been still
+struct Particle {
+    Vec2 position;
+    Vec2 velocity;
+    float radius;
+    Rgba color;
+    float life = INFINITY; // counts down every step, the particle is removed once it reaches 0
+    uint16_t still = 0;    // steps spent below the world's sleep speed, the particle sleeps once it reaches the limit
+};
+
+// Structure-of-arrays particle storage. The update kernels stream only the arrays they touch,
+// render code walks it like a container of Particle values.
+class ParticleStore {
+public:
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Particle;
+        using difference_type = int;
+        using pointer = void;
+        using reference = Particle;
+
+        Iterator(const ParticleStore* store, int index) : store(store), index(index) {}
+
+        Particle operator*() const { return store->Get(index); }
+        Iterator& operator++() { index++; return *this; }
+        bool operator==(const Iterator& other) const { return index == other.index; }
+        bool operator!=(const Iterator& other) const { return index != other.index; }
+
+    private:
+        const ParticleStore* store;
+        int index;
+    };
+
+    int Size() const { return (int)x.Size(); }
+
+    void Resize(int count);
+    void Reserve(int count);
+    void Clear() { Resize(0); }
+
+    // Write zeros over [begin, end) of every array, which may reach past Size up to the reserved capacity. Only
+    // for placing fresh pages: memory goes to the NUMA node of the thread that writes it first.
+    void Touch(int begin, int end);
+
+    // Append a particle, returns its index
+    int Add(const Particle& p);
+
+    Particle Get(int i) const { return {{x[i], y[i]}, {vx[i], vy[i]}, radius[i], color[i], life[i], still[i]}; }
+    void Set(int i, const Particle& p);
+
+    // Exchange every array with another store, no copying
+    void Swap(ParticleStore& other);
+
+    Iterator begin() const { return Iterator(this, 0); }
+    Iterator end() const { return Iterator(this, Size()); }
+
+    AlignedArray<float> x;
+    AlignedArray<float> y;
+    AlignedArray<float> vx;
+    AlignedArray<float> vy;
+    AlignedArray<float> radius;
+    AlignedArray<Rgba> color;
+    AlignedArray<float> life;
+    AlignedArray<uint16_t> still;
+
+    // Bumped whenever particles move to another index, so a snapshot can tell whether it still lines up
+    long long layout = 0;
+};
@@ -0,0 +1,20 @@
+// Small platform helpers shared by the threading code
+#pragma once
+
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+// Size of a cache line, used to pad per-worker state
+#define CACHE_LINE_SIZE 64
+
+// Hint to the CPU that we are in a spin-wait loop
+inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+    _mm_pause();
+#else
+    std::this_thread::yield();
+#endif
+}
@@ -0,0 +1,85 @@
+#include "random.h"
+
+#include "kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+#define RANDOM_TARGET __attribute__((target("avx2")))
+
+// High 32 bits of the unsigned 32x32 products in every lane
+RANDOM_TARGET static inline __m256i MulHi(__m256i a, __m256i m) {
+    __m256i even = _mm256_mul_epu32(a, m);
+    __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), m);
+    return _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA);
+}
+
+// Eight Philox evaluations side by side, one counter per lane
+RANDOM_TARGET static void FillBlocksAvx2(const int* indices, int count, uint32_t c1, uint32_t c2, uint32_t c3,
+                                         uint32_t key0, uint32_t key1, RandomBlock* out) {
+    const __m256i m0 = _mm256_set1_epi32((int)0xD2511F53u);
+    const __m256i m1 = _mm256_set1_epi32((int)0xCD9E8D57u);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i x0 = _mm256_loadu_si256((const __m256i*)(indices + i));
+        __m256i x1 = _mm256_set1_epi32((int)c1);
+        __m256i x2 = _mm256_set1_epi32((int)c2);
+        __m256i x3 = _mm256_set1_epi32((int)c3);
+        uint32_t k0 = key0;
+        uint32_t k1 = key1;
+
+        for (int round = 0; round < 10; round++) {
+            __m256i hi0 = MulHi(x0, m0);
+            __m256i lo0 = _mm256_mullo_epi32(x0, m0);
+            __m256i hi1 = MulHi(x2, m1);
+            __m256i lo1 = _mm256_mullo_epi32(x2, m1);
+
+            x0 = _mm256_xor_si256(_mm256_xor_si256(hi1, x1), _mm256_set1_epi32((int)k0));
+            x1 = lo1;
+            x2 = _mm256_xor_si256(_mm256_xor_si256(hi0, x3), _mm256_set1_epi32((int)k1));
+            x3 = lo0;
+
+            k0 += 0x9E3779B9u;
+            k1 += 0xBB67AE85u;
+        }
+
+        alignas(32) uint32_t words[4][8];
+        _mm256_store_si256((__m256i*)words[0], x0);
+        _mm256_store_si256((__m256i*)words[1], x1);
+        _mm256_store_si256((__m256i*)words[2], x2);
+        _mm256_store_si256((__m256i*)words[3], x3);
+        for (int lane = 0; lane < 8; lane++) {
+            out[i + lane] = {{words[0][lane], words[1][lane], words[2][lane], words[3][lane]}};
+        }
+    }
+
+    for (; i < count; i++) {
+        out[i] = Philox4x32((uint32_t)indices[i], c1, c2, c3, key0, key1);
+    }
+}
+
+static const bool kHasAvx2 = CpuSupports(KernelIsa::Avx2);
+#else
+static const bool kHasAvx2 = false;
+#endif
+
+bool RandomUsesAvx2() {
+    return kHasAvx2;
+}
+
+void CounterRandom::FillBlocks(RandomStream stream, const int* indices, int count, uint64_t step, uint32_t draw, RandomBlock* out) const {
+    const uint32_t c1 = (uint32_t)step;
+    const uint32_t c2 = (uint32_t)(step >> 32);
+    const uint32_t c3 = Lane(stream, draw);
+
+#if defined(__x86_64__) || defined(__i386__)
+    if (kHasAvx2) {
+        FillBlocksAvx2(indices, count, c1, c2, c3, key0, key1, out);
+        return;
+    }
+#endif
+    for (int i = 0; i < count; i++) {
+        out[i] = Philox4x32((uint32_t)indices[i], c1, c2, c3, key0, key1);
+    }
+}
@@ -0,0 +1,71 @@
+// Counter-based random numbers (Philox4x32-10), stateless so any worker can draw without sharing anything
+#pragma once
+
+#include <cstdint>
+
+// Four random 32-bit words from one Philox evaluation
+struct RandomBlock {
+    uint32_t word[4];
+};
+
+// What a draw is for, so different uses never share a counter
+enum class RandomStream : uint32_t {
+    Spawn = 1,
+    Respawn = 2,
+    Emit = 3,
+    Churn = 4
+};
+
+// Philox4x32 with 10 rounds. The same counter and key always give the same block.
+inline RandomBlock Philox4x32(uint32_t c0, uint32_t c1, uint32_t c2, uint32_t c3, uint32_t k0, uint32_t k1) {
+    for (int round = 0; round < 10; round++) {
+        uint64_t product0 = (uint64_t)0xD2511F53u * c0;
+        uint64_t product1 = (uint64_t)0xCD9E8D57u * c2;
+        uint32_t hi0 = (uint32_t)(product0 >> 32);
+        uint32_t hi1 = (uint32_t)(product1 >> 32);
+
+        c0 = hi1 ^ c1 ^ k0;
+        c1 = (uint32_t)product1;
+        c2 = hi0 ^ c3 ^ k1;
+        c3 = (uint32_t)product0;
+
+        k0 += 0x9E3779B9u;
+        k1 += 0xBB67AE85u;
+    }
+    return {{c0, c1, c2, c3}};
+}
+
+// Generator keyed by a seed. A draw is addressed by (stream, particle index, step, draw number) instead of
+// advancing hidden state, so the numbers a particle gets do not depend on which worker asks or in what order.
+class CounterRandom {
+public:
+    explicit CounterRandom(uint64_t seed = 0) : key0((uint32_t)seed), key1((uint32_t)(seed >> 32)) {}
+
+    // draw picks further blocks when four words are not enough for one particle
+    RandomBlock Block(RandomStream stream, uint32_t index, uint64_t step, uint32_t draw = 0) const {
+        return Philox4x32(index, (uint32_t)step, (uint32_t)(step >> 32), Lane(stream, draw), key0, key1);
+    }
+
+    // Blocks for a list of particle indices at once, eight at a time with AVX2 when the CPU has it.
+    // Gives the same blocks as calling Block for each index.
+    void FillBlocks(RandomStream stream, const int* indices, int count, uint64_t step, uint32_t draw, RandomBlock* out) const;
+
+private:
+    static uint32_t Lane(RandomStream stream, uint32_t draw) { return ((uint32_t)stream << 16) | draw; }
+
+    uint32_t key0;
+    uint32_t key1;
+};
+
+// Map a word to [min, max] inclusive, same contract as raylib's GetRandomValue
+inline int RandomRange(uint32_t word, int min, int max) {
+    return min + (int)(((uint64_t)word * (uint64_t)(max - min + 1)) >> 32);
+}
+
+// Map a word to [0, 1)
+inline float RandomUnit(uint32_t word) {
+    return (float)(word >> 8) * (1.0f / 16777216.0f);
+}
+
+// True when FillBlocks uses the AVX2 path on this CPU
+bool RandomUsesAvx2();
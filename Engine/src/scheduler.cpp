@@ -0,0 +1,140 @@
+#include "scheduler.h"
+
+#include <algorithm>
+
+// Failed steal rounds before an idle worker yields its core, matters when threads outnumber cores
+static const int kYieldAfter = 64;
+
+bool RangeDeque::Push(RangeTask task) {
+    int64_t b = bottom.load(std::memory_order_relaxed);
+    int64_t t = top.load(std::memory_order_acquire);
+    if (b - t >= kCapacity) return false;
+
+    buffer[b % kCapacity].store(Pack(task), std::memory_order_relaxed);
+    bottom.store(b + 1, std::memory_order_seq_cst);
+    return true;
+}
+
+bool RangeDeque::Pop(RangeTask& task) {
+    int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+    bottom.store(b, std::memory_order_seq_cst);
+    int64_t t = top.load(std::memory_order_seq_cst);
+
+    if (t > b) {
+        // Empty, undo the reservation
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return false;
+    }
+
+    task = Unpack(buffer[b % kCapacity].load(std::memory_order_relaxed));
+    if (t == b) {
+        // Last item, race the thieves for it
+        bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return won;
+    }
+    return true;
+}
+
+bool RangeDeque::Steal(RangeTask& task) {
+    int64_t t = top.load(std::memory_order_seq_cst);
+    int64_t b = bottom.load(std::memory_order_seq_cst);
+    if (t >= b) return false;
+
+    RangeTask stolen = Unpack(buffer[t % kCapacity].load(std::memory_order_relaxed));
+    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        return false;
+    }
+    task = stolen;
+    return true;
+}
+
+TaskScheduler::TaskScheduler(WorkerPool& pool) : pool(pool), queues(pool.ThreadCount()) {
+    for (int worker = 0; worker < (int)queues.size(); worker++) {
+        queues[worker].victimSeed = 2654435761u * (worker + 1);
+    }
+}
+
+void TaskScheduler::ResetStats() {
+    for (auto& queue : queues) {
+        queue.stats = SchedulerStats();
+    }
+}
+
+void TaskScheduler::Run(int begin, int end, int grainSize, RangeFunction function, void* context) {
+    if (end <= begin) return;
+    grainSize = std::max(grainSize, 1);
+
+    // Not worth waking anyone up
+    const int workers = pool.ThreadCount();
+    if (workers == 1 || end - begin <= grainSize) {
+        function(context, begin, end, 0);
+        queues[0].stats.tasks++;
+        return;
+    }
+
+    // Seed every deque with an even share, the pool's start barrier publishes them
+    const int count = end - begin;
+    const int share = (count + workers - 1) / workers;
+    remaining.store(count, std::memory_order_relaxed);
+    for (int worker = 0; worker < workers; worker++) {
+        int first = std::min(begin + worker * share, end);
+        int last = std::min(first + share, end);
+        if (first < last) queues[worker].deque.Push({first, last});
+    }
+
+    pool.Run([&](int worker) {
+        WorkerLoop(worker, grainSize, function, context);
+    });
+}
+
+void TaskScheduler::WorkerLoop(int worker, int grainSize, RangeFunction function, void* context) {
+    WorkerQueue& self = queues[worker];
+    RangeTask task;
+    int idleRounds = 0;
+
+    while (remaining.load(std::memory_order_acquire) > 0) {
+        if (!self.deque.Pop(task) && !TrySteal(worker, task)) {
+            self.stats.idleSpins++;
+            if (++idleRounds < kYieldAfter) {
+                CpuRelax();
+            } else {
+                std::this_thread::yield();
+            }
+            continue;
+        }
+        idleRounds = 0;
+
+        // Keep the lower half, leave the upper half for this worker or a thief
+        while (task.end - task.begin > grainSize) {
+            int middle = task.begin + (task.end - task.begin) / 2;
+            if (!self.deque.Push({middle, task.end})) break;
+            task.end = middle;
+        }
+
+        function(context, task.begin, task.end, worker);
+        self.stats.tasks++;
+        remaining.fetch_sub(task.end - task.begin, std::memory_order_acq_rel);
+    }
+}
+
+bool TaskScheduler::TrySteal(int worker, RangeTask& task) {
+    WorkerQueue& self = queues[worker];
+    const int workers = (int)queues.size();
+
+    // Start at a random victim so thieves do not all hit the same deque
+    self.victimSeed ^= self.victimSeed << 13;
+    self.victimSeed ^= self.victimSeed >> 17;
+    self.victimSeed ^= self.victimSeed << 5;
+    int start = (int)(self.victimSeed % (uint32_t)workers);
+
+    for (int i = 0; i < workers; i++) {
+        int victim = (start + i) % workers;
+        if (victim == worker) continue;
+        if (queues[victim].deque.Steal(task)) {
+            self.stats.steals++;
+            return true;
+        }
+    }
+    return false;
+}
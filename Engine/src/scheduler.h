@@ -0,0 +1,85 @@
+// Work-stealing scheduler for range loops, runs on the workers of a WorkerPool
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "platform.h"
+#include "thread_pool.h"
+
+// Default number of indices a task is split down to
+#define DEFAULT_GRAIN_SIZE 1024
+
+// Half-open index range [begin, end)
+struct RangeTask {
+    int begin;
+    int end;
+};
+
+// How a worker got its work since the last ResetStats
+struct SchedulerStats {
+    long long tasks = 0;     // ranges executed
+    long long steals = 0;    // ranges taken from another worker's deque
+    long long idleSpins = 0; // loops spent with no work found anywhere
+};
+
+// Fixed capacity Chase-Lev deque, the owner pushes and pops at the bottom and thieves steal from the top
+class RangeDeque {
+public:
+    bool Push(RangeTask task);
+    bool Pop(RangeTask& task);
+    bool Steal(RangeTask& task);
+
+private:
+    static const int kCapacity = 256;
+
+    static uint64_t Pack(RangeTask task) { return ((uint64_t)(uint32_t)task.begin << 32) | (uint32_t)task.end; }
+    static RangeTask Unpack(uint64_t value) { return {(int)(uint32_t)(value >> 32), (int)(uint32_t)value}; }
+
+    std::atomic<int64_t> top{0};
+    std::atomic<int64_t> bottom{0};
+    std::atomic<uint64_t> buffer[kCapacity];
+};
+
+class TaskScheduler {
+public:
+    explicit TaskScheduler(WorkerPool& pool);
+
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    WorkerPool& Pool() { return pool; }
+    int WorkerCount() const { return pool.ThreadCount(); }
+
+    // Call body(begin, end, worker) over [begin, end) in pieces of at most grainSize indices.
+    // Each worker starts on an even share and splits it as it goes, idle workers steal the halves.
+    template <typename Body>
+    void ParallelFor(int begin, int end, int grainSize, Body&& body) {
+        using BodyType = typename std::remove_reference<Body>::type;
+        Run(begin, end, grainSize, [](void* context, int first, int last, int worker) {
+            (*static_cast<BodyType*>(context))(first, last, worker);
+        }, &body);
+    }
+
+    SchedulerStats Stats(int worker) const { return queues[worker].stats; }
+    void ResetStats();
+
+private:
+    using RangeFunction = void (*)(void* context, int begin, int end, int worker);
+
+    struct alignas(CACHE_LINE_SIZE) WorkerQueue {
+        RangeDeque deque;
+        SchedulerStats stats;
+        uint32_t victimSeed = 1;
+    };
+
+    void Run(int begin, int end, int grainSize, RangeFunction function, void* context);
+    void WorkerLoop(int worker, int grainSize, RangeFunction function, void* context);
+    bool TrySteal(int worker, RangeTask& task);
+
+    WorkerPool& pool;
+    std::vector<WorkerQueue> queues;
+    std::atomic<int> remaining{0};
+};
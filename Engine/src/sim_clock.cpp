@@ -0,0 +1,23 @@
+#include "sim_clock.h"
+
+#include <algorithm>
+
+FixedStepClock::FixedStepClock(float stepRate, int maxSubsteps)
+    : stepRate(stepRate), stepSeconds(1.0f / stepRate), maxSubsteps(std::max(maxSubsteps, 1)) {}
+
+int FixedStepClock::Advance(double frameSeconds) {
+    accumulator += std::max(frameSeconds, 0.0);
+
+    int steps = (int)(accumulator / stepSeconds);
+    accumulator -= steps * (double)stepSeconds;
+
+    if (steps > maxSubsteps) {
+        droppedSteps += steps - maxSubsteps;
+        steps = maxSubsteps;
+    }
+    return steps;
+}
+
+void FixedStepClock::Reset() {
+    accumulator = 0.0;
+}
@@ -0,0 +1,40 @@
+// Fixed-step simulation clock with a leftover fraction for render interpolation
+#pragma once
+
+#define DEFAULT_STEP_RATE 60.0f
+#define DEFAULT_MAX_SUBSTEPS 4
+
+// Frames feed in however much real time passed, the simulation consumes it in whole steps of 1 / stepRate
+// seconds. The simulation therefore behaves the same at any frame rate, and since a frame never runs more than
+// maxSubsteps steps the physics cost per second is bounded even when frames get slow.
+class FixedStepClock {
+public:
+    explicit FixedStepClock(float stepRate = DEFAULT_STEP_RATE, int maxSubsteps = DEFAULT_MAX_SUBSTEPS);
+
+    // Add one frame of real time, returns how many steps to run now. Time past maxSubsteps steps is dropped
+    // instead of carried over, so one long hitch does not turn into a spiral of ever longer frames.
+    int Advance(double frameSeconds);
+
+    // Forget any banked time
+    void Reset();
+
+    float StepRate() const { return stepRate; }
+    float StepSeconds() const { return stepSeconds; }
+    int MaxSubsteps() const { return maxSubsteps; }
+
+    // Fraction of a step banked after the last Advance, in [0, 1). Draw previous + (current - previous) * Alpha()
+    float Alpha() const { return (float)(accumulator / stepSeconds); }
+
+    // Seconds until the next step is due
+    double TimeToNextStep() const { return stepSeconds - accumulator; }
+
+    // Steps skipped because a frame would have needed more than maxSubsteps
+    long long DroppedSteps() const { return droppedSteps; }
+
+private:
+    float stepRate;
+    float stepSeconds;
+    int maxSubsteps;
+    double accumulator = 0.0;
+    long long droppedSteps = 0;
+};
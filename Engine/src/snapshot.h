@@ -0,0 +1,49 @@
+// Lock-free triple buffer for handing finished frames from the physics thread to the render thread
+#pragma once
+
+#include <atomic>
+
+#include "platform.h"
+
+// Three slots: the writer fills its back slot, the reader holds its front slot and the third sits in the middle.
+// Publish swaps the back slot into the middle and Acquire swaps the middle out to the front when it holds a newer
+// frame. Both are a single atomic exchange, so neither side ever waits for the other and the reader always sees
+// the most recent complete frame. Only one writer thread and one reader thread may use a buffer.
+template <typename T>
+class TripleBuffer {
+public:
+    // Slot the writer fills next, not visible to the reader until Publish
+    T& WriteSlot() { return slots[writer.index]; }
+
+    // Hand the filled slot to the reader, replacing any frame it has not picked up yet
+    void Publish() {
+        int previous = middle.exchange(writer.index | kFresh, std::memory_order_acq_rel);
+        writer.index = previous & kIndexMask;
+    }
+
+    // Latest published frame, stays valid and unchanged until the next Acquire on the reader thread
+    const T& Acquire() {
+        if (middle.load(std::memory_order_relaxed) & kFresh) {
+            int previous = middle.exchange(reader.index, std::memory_order_acq_rel);
+            reader.index = previous & kIndexMask;
+        }
+        return slots[reader.index];
+    }
+
+    // True when a frame has been published since the last Acquire
+    bool HasFresh() const { return (middle.load(std::memory_order_relaxed) & kFresh) != 0; }
+
+private:
+    static const int kIndexMask = 3;
+    static const int kFresh = 4;
+
+    // Each side's index lives on its own cache line so the threads do not bounce it between cores
+    struct alignas(CACHE_LINE_SIZE) Side {
+        int index;
+    };
+
+    T slots[3];
+    Side writer = {0};
+    Side reader = {1};
+    alignas(CACHE_LINE_SIZE) std::atomic<int> middle{2};
+};
@@ -0,0 +1,150 @@
+#include "spatial_grid.h"
+
+#include <cmath>
+
+#include "scheduler.h"
+#include "trace.h"
+
+// At most this many cells per particle, so a world of tiny particles does not allocate millions of empty cells
+static const float kMaxCellsPerParticle = 1.0f;
+
+// Particles per histogram block, fewer blocks keeps the blocks x cells histogram small
+static const int kParticlesPerBlock = 8192;
+
+// Cells per prefix sum chunk
+static const int kCellsPerChunk = 4096;
+
+float MaxRadius(const ParticleStore& particles) {
+    float maxRadius = 0.0f;
+    for (int i = 0; i < particles.Size(); i++) {
+        maxRadius = std::max(maxRadius, particles.radius[i]);
+    }
+    return maxRadius;
+}
+
+void SpatialGrid::Layout(int count, float width, float height, float minCellSize) {
+    float areaCellSize = std::sqrt(width * height / (kMaxCellsPerParticle * std::max(count, 1)));
+    cellSize = std::max(minCellSize, areaCellSize);
+    columns = std::max(1, (int)std::ceil(width / cellSize));
+    rows = std::max(1, (int)std::ceil(height / cellSize));
+
+    cellStart.Resize(CellCount() + 1);
+    sortedIndex.Resize(count);
+    particleCell.Resize(count);
+}
+
+void SpatialGrid::Build(const ParticleStore& particles, float width, float height, float minCellSize) {
+    TRACE_ZONE("Broad Phase");
+    const int count = particles.Size();
+    Layout(count, width, height, minCellSize);
+    const int cells = CellCount();
+
+    // Count particles per cell
+    for (int c = 0; c <= cells; c++) cellStart[c] = 0;
+    for (int i = 0; i < count; i++) {
+        int cell = RowOf(particles.y[i]) * columns + ColumnOf(particles.x[i]);
+        particleCell[i] = cell;
+        cellStart[cell + 1]++;
+    }
+
+    // Prefix sum turns counts into start offsets
+    for (int c = 0; c < cells; c++) cellStart[c + 1] += cellStart[c];
+
+    // Scatter, cellStart[c] walks forward and is restored afterwards
+    for (int i = 0; i < count; i++) {
+        sortedIndex[cellStart[particleCell[i]]++] = i;
+    }
+    for (int c = cells; c > 0; c--) cellStart[c] = cellStart[c - 1];
+    cellStart[0] = 0;
+}
+
+void SpatialGrid::Build(const ParticleStore& particles, float width, float height, float minCellSize, TaskScheduler& scheduler) {
+    const int count = particles.Size();
+    const int blocks = std::min(scheduler.WorkerCount(), (count + kParticlesPerBlock - 1) / kParticlesPerBlock);
+    if (blocks <= 1) {
+        Build(particles, width, height, minCellSize);
+        return;
+    }
+    TRACE_ZONE("Broad Phase");
+
+    Layout(count, width, height, minCellSize);
+    const int cells = CellCount();
+    const int blockSize = (count + blocks - 1) / blocks;
+    blockCounts.Resize((size_t)blocks * cells);
+
+    // 1. Each block histograms its own contiguous particle range into its own row
+    scheduler.ParallelFor(0, blocks, 1, [&](int first, int last, int) {
+        TRACE_ZONE("Grid Count");
+        for (int block = first; block < last; block++) {
+            int* counts = blockCounts.Data() + (size_t)block * cells;
+            for (int c = 0; c < cells; c++) counts[c] = 0;
+
+            const int end = std::min((block + 1) * blockSize, count);
+            for (int i = block * blockSize; i < end; i++) {
+                int cell = RowOf(particles.y[i]) * columns + ColumnOf(particles.x[i]);
+                particleCell[i] = cell;
+                counts[cell]++;
+            }
+        }
+    });
+
+    // 2. Per chunk of cells, turn the block counts into each block's offset inside the cell, walking the
+    // histogram rows in order, then scan the cell totals into offsets inside the chunk
+    const int chunks = (cells + kCellsPerChunk - 1) / kCellsPerChunk;
+    chunkSums.Resize(chunks);
+    scheduler.ParallelFor(0, chunks, 1, [&](int first, int last, int) {
+        TRACE_ZONE("Grid Offsets");
+        for (int chunk = first; chunk < last; chunk++) {
+            const int cellBegin = chunk * kCellsPerChunk;
+            const int cellEnd = std::min(cellBegin + kCellsPerChunk, cells);
+            for (int c = cellBegin; c < cellEnd; c++) cellStart[c] = 0;
+
+            for (int block = 0; block < blocks; block++) {
+                int* counts = blockCounts.Data() + (size_t)block * cells;
+                for (int c = cellBegin; c < cellEnd; c++) {
+                    int blockCount = counts[c];
+                    counts[c] = cellStart[c];
+                    cellStart[c] += blockCount;
+                }
+            }
+
+            int chunkTotal = 0;
+            for (int c = cellBegin; c < cellEnd; c++) {
+                int cellTotal = cellStart[c];
+                cellStart[c] = chunkTotal;
+                chunkTotal += cellTotal;
+            }
+            chunkSums[chunk] = chunkTotal;
+        }
+    });
+
+    // 3. Exclusive scan of the chunk totals, only a handful of values
+    int running = 0;
+    for (int chunk = 0; chunk < chunks; chunk++) {
+        int chunkTotal = chunkSums[chunk];
+        chunkSums[chunk] = running;
+        running += chunkTotal;
+    }
+    cellStart[cells] = running;
+
+    // 4. Shift every cell by its chunk's start
+    scheduler.ParallelFor(0, chunks, 1, [&](int first, int last, int) {
+        for (int chunk = first; chunk < last; chunk++) {
+            const int cellEnd = std::min((chunk + 1) * kCellsPerChunk, cells);
+            for (int c = chunk * kCellsPerChunk; c < cellEnd; c++) cellStart[c] += chunkSums[chunk];
+        }
+    });
+
+    // 5. Scatter, each block owns a disjoint run of slots in every cell so no two writes collide
+    scheduler.ParallelFor(0, blocks, 1, [&](int first, int last, int) {
+        TRACE_ZONE("Grid Scatter");
+        for (int block = first; block < last; block++) {
+            int* offsets = blockCounts.Data() + (size_t)block * cells;
+            const int end = std::min((block + 1) * blockSize, count);
+            for (int i = block * blockSize; i < end; i++) {
+                int cell = particleCell[i];
+                sortedIndex[cellStart[cell] + offsets[cell]++] = i;
+            }
+        }
+    });
+}
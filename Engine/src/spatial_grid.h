@@ -0,0 +1,70 @@
+// Uniform grid over particle centers, shared by every neighbour query in the engine
+#pragma once
+
+#include <algorithm>
+
+#include "aligned_array.h"
+#include "particles.h"
+
+class TaskScheduler;
+
+// Cells are at least minCellSize wide (one largest diameter for collisions), so two particles closer than
+// that are always in the same or neighbouring cells. Building is a counting sort into one flat index array,
+// no per-cell allocations.
+class SpatialGrid {
+public:
+    // Bin every particle by its center, particles outside the bounds go to the nearest edge cell
+    void Build(const ParticleStore& particles, float width, float height, float minCellSize);
+
+    // Same result as Build, binned in parallel: per-block histograms, a parallel exclusive prefix sum over the
+    // cells and a scatter. Blocks are contiguous particle ranges so the order inside a cell is always ascending
+    // particle index, whatever the worker count.
+    void Build(const ParticleStore& particles, float width, float height, float minCellSize, TaskScheduler& scheduler);
+
+    int Columns() const { return columns; }
+    int Rows() const { return rows; }
+    int CellCount() const { return columns * rows; }
+    float CellSize() const { return cellSize; }
+
+    // Particles in cell c are ParticleAt(CellBegin(c)) .. ParticleAt(CellEnd(c) - 1)
+    int CellBegin(int cell) const { return cellStart[cell]; }
+    int CellEnd(int cell) const { return cellStart[cell + 1]; }
+    int ParticleAt(int slot) const { return sortedIndex[slot]; }
+    int CellOf(int particle) const { return particleCell[particle]; }
+
+    int ColumnOf(float x) const { return std::min(std::max((int)(x / cellSize), 0), columns - 1); }
+    int RowOf(float y) const { return std::min(std::max((int)(y / cellSize), 0), rows - 1); }
+
+    // Call visit(particle) for every particle in the 3x3 cells around (x, y), cell by cell in row order
+    template <typename Visit>
+    void ForEachNear(float x, float y, Visit&& visit) const {
+        const int column = ColumnOf(x);
+        const int row = RowOf(y);
+        for (int r = std::max(row - 1, 0); r <= std::min(row + 1, rows - 1); r++) {
+            for (int c = std::max(column - 1, 0); c <= std::min(column + 1, columns - 1); c++) {
+                const int cell = r * columns + c;
+                for (int slot = cellStart[cell]; slot < cellStart[cell + 1]; slot++) {
+                    visit(sortedIndex[slot]);
+                }
+            }
+        }
+    }
+
+private:
+    void Layout(int count, float width, float height, float minCellSize);
+
+    int columns = 0;
+    int rows = 0;
+    float cellSize = 0.0f;
+
+    AlignedArray<int> cellStart;    // CellCount() + 1 offsets into sortedIndex
+    AlignedArray<int> sortedIndex;  // particle indices ordered by cell
+    AlignedArray<int> particleCell; // cell of each particle
+
+    // Parallel build scratch, kept between frames so rebuilding allocates nothing
+    AlignedArray<int> blockCounts;  // blocks x cells histogram, then each block's running offset per cell
+    AlignedArray<int> chunkSums;    // per-chunk totals for the prefix sum
+};
+
+// Largest radius in the store
+float MaxRadius(const ParticleStore& particles);
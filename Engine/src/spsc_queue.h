@@ -0,0 +1,68 @@
+// Bounded lock-free queue between one producer thread and one consumer thread
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+#include "aligned_array.h"
+#include "platform.h"
+
+// Ring of slots indexed by two ever-growing counters. The producer only writes the tail and the consumer only
+// writes the head, each on its own cache line, so pushing and popping are one store each and never wait.
+// Each side also keeps a stale copy of the other's counter and only reloads it when the ring looks full or empty.
+template <typename T>
+class SpscQueue {
+public:
+    // Capacity is rounded up to a power of two
+    explicit SpscQueue(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) size *= 2;
+        slots.Resize(size);
+        mask = size - 1;
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    size_t Capacity() const { return mask + 1; }
+
+    // Producer side, returns false instead of waiting when the queue is full
+    bool TryPush(const T& value) {
+        size_t tail = producer.tail.load(std::memory_order_relaxed);
+        if (tail - producer.cachedHead > mask) {
+            producer.cachedHead = consumer.head.load(std::memory_order_acquire);
+            if (tail - producer.cachedHead > mask) return false;
+        }
+        slots[tail & mask] = value;
+        producer.tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side, returns false when the queue is empty
+    bool TryPop(T& value) {
+        size_t head = consumer.head.load(std::memory_order_relaxed);
+        if (head == consumer.cachedTail) {
+            consumer.cachedTail = producer.tail.load(std::memory_order_acquire);
+            if (head == consumer.cachedTail) return false;
+        }
+        value = slots[head & mask];
+        consumer.head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    struct alignas(CACHE_LINE_SIZE) Producer {
+        std::atomic<size_t> tail{0};
+        size_t cachedHead = 0;
+    };
+
+    struct alignas(CACHE_LINE_SIZE) Consumer {
+        std::atomic<size_t> head{0};
+        size_t cachedTail = 0;
+    };
+
+    AlignedArray<T> slots;
+    size_t mask = 0;
+    Producer producer;
+    Consumer consumer;
+};
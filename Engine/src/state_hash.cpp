@@ -0,0 +1,85 @@
+#include "state_hash.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "scheduler.h"
+
+// Particles per hashed block, fixed so the result does not depend on how the work is split
+static const int kHashBlock = 16384;
+
+static const uint64_t kHashSeed = 0x9E3779B97F4A7C15ull;
+static const uint64_t kHashPrime = 0xFF51AFD7ED558CCDull;
+
+// Final avalanche from MurmurHash3, every input bit affects every output bit
+static inline uint64_t Avalanche(uint64_t h) {
+    h ^= h >> 33;
+    h *= kHashPrime;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+uint64_t HashCombine(uint64_t hash, uint64_t value) {
+    return Avalanche(hash ^ (value + kHashSeed + (hash << 6) + (hash >> 2)));
+}
+
+// Four independent lanes over 8-byte chunks so the multiplies overlap, then the tail byte by byte
+static uint64_t HashBytes(const void* data, size_t size, uint64_t seed) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t lane[4] = {seed, seed + 1, seed + 2, seed + 3};
+
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        for (int l = 0; l < 4; l++) {
+            uint64_t v;
+            memcpy(&v, bytes + i + l * 8, 8);
+            lane[l] = (lane[l] ^ v) * kHashPrime;
+            lane[l] ^= lane[l] >> 29;
+        }
+    }
+
+    uint64_t h = seed ^ size;
+    for (int l = 0; l < 4; l++) h = HashCombine(h, lane[l]);
+    for (; i < size; i++) h = (h ^ bytes[i]) * kHashPrime;
+    return Avalanche(h);
+}
+
+static uint64_t HashBlock(const ParticleStore& particles, int block) {
+    const int begin = block * kHashBlock;
+    const int end = std::min(begin + kHashBlock, particles.Size());
+    const size_t count = end - begin;
+
+    uint64_t h = HashBytes(particles.x.Data() + begin, count * sizeof(float), kHashSeed);
+    h = HashCombine(h, HashBytes(particles.y.Data() + begin, count * sizeof(float), kHashSeed));
+    h = HashCombine(h, HashBytes(particles.vx.Data() + begin, count * sizeof(float), kHashSeed));
+    h = HashCombine(h, HashBytes(particles.vy.Data() + begin, count * sizeof(float), kHashSeed));
+    h = HashCombine(h, HashBytes(particles.radius.Data() + begin, count * sizeof(float), kHashSeed));
+    h = HashCombine(h, HashBytes(particles.color.Data() + begin, count * sizeof(Rgba), kHashSeed));
+    h = HashCombine(h, HashBytes(particles.life.Data() + begin, count * sizeof(float), kHashSeed));
+    h = HashCombine(h, HashBytes(particles.still.Data() + begin, count * sizeof(uint16_t), kHashSeed));
+    return h;
+}
+
+uint64_t StateHasher::Fold(int blocks) const {
+    uint64_t h = HashCombine(kHashSeed, (uint64_t)blocks);
+    for (int b = 0; b < blocks; b++) h = HashCombine(h, blockHashes[b]);
+    return h;
+}
+
+uint64_t StateHasher::Hash(const ParticleStore& particles) {
+    const int blocks = (particles.Size() + kHashBlock - 1) / kHashBlock;
+    blockHashes.Resize(blocks);
+    for (int b = 0; b < blocks; b++) blockHashes[b] = HashBlock(particles, b);
+    return Fold(blocks);
+}
+
+uint64_t StateHasher::Hash(const ParticleStore& particles, TaskScheduler& scheduler) {
+    const int blocks = (particles.Size() + kHashBlock - 1) / kHashBlock;
+    blockHashes.Resize(blocks);
+    scheduler.ParallelFor(0, blocks, 1, [&](int begin, int end, int) {
+        for (int b = begin; b < end; b++) blockHashes[b] = HashBlock(particles, b);
+    });
+    return Fold(blocks);
+}
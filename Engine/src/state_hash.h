@@ -0,0 +1,25 @@
+// Fast hash of the particle state, for proving two runs produced the same bits
+#pragma once
+
+#include <cstdint>
+
+#include "aligned_array.h"
+#include "particles.h"
+
+class TaskScheduler;
+
+// Hashes fixed-size blocks of particles and folds the block hashes in order. The blocks do not depend on the
+// worker count, so the serial and parallel versions give the same value for the same state.
+class StateHasher {
+public:
+    uint64_t Hash(const ParticleStore& particles);
+    uint64_t Hash(const ParticleStore& particles, TaskScheduler& scheduler);
+
+private:
+    uint64_t Fold(int blocks) const;
+
+    AlignedArray<uint64_t> blockHashes;
+};
+
+// Mix one more 64-bit value into a running hash
+uint64_t HashCombine(uint64_t hash, uint64_t value);
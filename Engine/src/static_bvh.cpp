@@ -0,0 +1,207 @@
+#include "static_bvh.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Boxes a leaf may hold, smaller leaves are only split when the heuristic says it pays
+static const int kLeafSize = 4;
+
+// Candidate split planes per axis are the borders between this many equal-width centroid bins
+static const int kSahBins = 16;
+
+struct SahBin {
+    int count = 0;
+    Aabb bounds = {INFINITY, INFINITY, -INFINITY, -INFINITY};
+};
+
+static Aabb Union(const Aabb& a, const Aabb& b) {
+    return {std::min(a.minX, b.minX), std::min(a.minY, b.minY), std::max(a.maxX, b.maxX), std::max(a.maxY, b.maxY)};
+}
+
+// The 2D counterpart of surface area: how likely a query is to reach a node grows with its perimeter
+static float HalfPerimeter(const Aabb& box) {
+    return (box.maxX - box.minX) + (box.maxY - box.minY);
+}
+
+static float Centroid(const Aabb& box, int axis) {
+    return axis == 0 ? 0.5f * (box.minX + box.maxX) : 0.5f * (box.minY + box.maxY);
+}
+
+static int BinOf(float centroid, float low, float extent) {
+    return std::min((int)((centroid - low) * (kSahBins / extent)), kSahBins - 1);
+}
+
+void StaticBvh::Build(const Aabb* source, int count) {
+    input.Resize(count);
+    order.Resize(count);
+    for (int i = 0; i < count; i++) {
+        input[i] = source[i];
+        order[i] = i;
+    }
+
+    nodes.Clear();
+    nodes.Reserve(2 * (size_t)count);
+    if (count > 0) BuildNode(0, count);
+
+    boxes.Resize(count);
+    boxIndex.Resize(count);
+    for (int k = 0; k < count; k++) {
+        boxes[k] = input[order[k]];
+        boxIndex[k] = order[k];
+    }
+}
+
+// Nodes are appended in depth-first order, so a subtree ends where the next node after it starts
+int StaticBvh::BuildNode(int begin, int end) {
+    const int index = (int)nodes.Size();
+    nodes.PushBack(Node());
+
+    Aabb bounds = input[order[begin]];
+    Aabb centroids = {Centroid(bounds, 0), Centroid(bounds, 1), Centroid(bounds, 0), Centroid(bounds, 1)};
+    for (int k = begin + 1; k < end; k++) {
+        const Aabb& box = input[order[k]];
+        bounds = Union(bounds, box);
+        centroids = Union(centroids, {Centroid(box, 0), Centroid(box, 1), Centroid(box, 0), Centroid(box, 1)});
+    }
+    nodes[index].bounds = bounds;
+
+    const int mid = Split(begin, end, bounds, centroids);
+    if (mid < 0) {
+        nodes[index].first = begin;
+        nodes[index].count = end - begin;
+        nodes[index].skip = index + 1;
+        return index;
+    }
+
+    BuildNode(begin, mid);
+    BuildNode(mid, end);
+    nodes[index].first = 0;
+    nodes[index].count = 0;
+    nodes[index].skip = (int)nodes.Size();
+    return index;
+}
+
+// Binned SAH over both axes. Returns where [begin, end) of the order was partitioned, or -1 to make a leaf.
+int StaticBvh::Split(int begin, int end, const Aabb& bounds, const Aabb& centroidBounds) {
+    const int count = end - begin;
+
+    float bestCost = INFINITY;
+    int bestAxis = -1;
+    int bestBin = 0;
+    for (int axis = 0; axis < 2; axis++) {
+        const float low = axis == 0 ? centroidBounds.minX : centroidBounds.minY;
+        const float extent = (axis == 0 ? centroidBounds.maxX : centroidBounds.maxY) - low;
+        if (extent <= 0.0f) continue;
+
+        SahBin bins[kSahBins];
+        for (int k = begin; k < end; k++) {
+            const Aabb& box = input[order[k]];
+            SahBin& bin = bins[BinOf(Centroid(box, axis), low, extent)];
+            bin.count++;
+            bin.bounds = Union(bin.bounds, box);
+        }
+
+        // Sweep from the right to get what lies above every plane, then from the left to price each plane
+        float rightArea[kSahBins];
+        int rightCount[kSahBins];
+        SahBin right;
+        for (int b = kSahBins - 1; b > 0; b--) {
+            right.count += bins[b].count;
+            right.bounds = Union(right.bounds, bins[b].bounds);
+            rightArea[b] = HalfPerimeter(right.bounds);
+            rightCount[b] = right.count;
+        }
+        SahBin left;
+        for (int b = 0; b < kSahBins - 1; b++) {
+            left.count += bins[b].count;
+            left.bounds = Union(left.bounds, bins[b].bounds);
+            if (left.count == 0 || rightCount[b + 1] == 0) continue;
+
+            float cost = left.count * HalfPerimeter(left.bounds) + rightCount[b + 1] * rightArea[b + 1];
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestBin = b;
+            }
+        }
+    }
+
+    // Visiting a node costs about as much as testing one box
+    const float parentArea = HalfPerimeter(bounds);
+    if (count <= kLeafSize && (bestAxis < 0 || parentArea + bestCost >= count * parentArea)) return -1;
+
+    // Every centroid in the same place, any halving is as good as another
+    if (bestAxis < 0) return begin + count / 2;
+
+    const float low = bestAxis == 0 ? centroidBounds.minX : centroidBounds.minY;
+    const float extent = (bestAxis == 0 ? centroidBounds.maxX : centroidBounds.maxY) - low;
+    int* first = order.Data() + begin;
+    int* middle = std::partition(first, order.Data() + end, [&](int i) {
+        return BinOf(Centroid(input[i], bestAxis), low, extent) <= bestBin;
+    });
+    return (int)(middle - order.Data());
+}
+
+bool PushOutOfBox(const Aabb& box, float radius, float& x, float& y, float& nx, float& ny) {
+    // Closest point of the box to the center
+    const float closestX = std::min(std::max(x, box.minX), box.maxX);
+    const float closestY = std::min(std::max(y, box.minY), box.maxY);
+    const float dx = x - closestX;
+    const float dy = y - closestY;
+    const float distanceSquared = dx * dx + dy * dy;
+    if (distanceSquared > 0.0f && distanceSquared >= radius * radius) return false;
+
+    float depth = 0.0f;
+    nx = 0.0f;
+    ny = 0.0f;
+    if (distanceSquared > 0.0f) {
+        const float distance = std::sqrt(distanceSquared);
+        nx = dx / distance;
+        ny = dy / distance;
+        depth = radius - distance;
+    } else {
+        // Center inside the box, leave through the nearest face
+        const float left = x - box.minX;
+        const float right = box.maxX - x;
+        const float top = y - box.minY;
+        const float bottom = box.maxY - y;
+        depth = std::min(std::min(left, right), std::min(top, bottom));
+        if (depth == top) ny = -1.0f;
+        else if (depth == bottom) ny = 1.0f;
+        else if (depth == left) nx = -1.0f;
+        else nx = 1.0f;
+        depth += radius;
+    }
+
+    x += nx * depth;
+    y += ny * depth;
+    return true;
+}
+
+void StaticBvh::CollideRange(ParticleStore& particles, int begin, int end, float restitution) const {
+    if (Empty()) return;
+
+    float* x = particles.x.Data();
+    float* y = particles.y.Data();
+    float* vx = particles.vx.Data();
+    float* vy = particles.vy.Data();
+    const float* radius = particles.radius.Data();
+
+    for (int i = begin; i < end; i++) {
+        const float r = radius[i];
+        const Aabb reach = {x[i] - r, y[i] - r, x[i] + r, y[i] + r};
+
+        Query(reach, [&](const Aabb& box, int) {
+            float nx = 0.0f;
+            float ny = 0.0f;
+            if (!PushOutOfBox(box, r, x[i], y[i], nx, ny)) return;
+
+            // Only motion into the box is reflected
+            const float into = vx[i] * nx + vy[i] * ny;
+            if (into < 0.0f) {
+                vx[i] -= (1.0f + restitution) * into * nx;
+                vy[i] -= (1.0f + restitution) * into * ny;
+            }
+        });
+    }
+}
@@ -0,0 +1,79 @@
+// Bounding volume hierarchy over static level geometry, built once and queried by every worker
+#pragma once
+
+#include "aligned_array.h"
+#include "particles.h"
+
+// Axis-aligned rectangle, such as a level platform
+struct Aabb {
+    float minX;
+    float minY;
+    float maxX;
+    float maxY;
+};
+
+inline bool Overlaps(const Aabb& a, const Aabb& b) {
+    return a.minX <= b.maxX && b.minX <= a.maxX && a.minY <= b.maxY && b.minY <= a.maxY;
+}
+
+// Move a circle out of a box along the shortest way, a center inside the box leaves through the nearest face.
+// Returns false when they do not overlap, otherwise sets the outward normal.
+bool PushOutOfBox(const Aabb& box, float radius, float& x, float& y, float& nx, float& ny);
+
+// Binary tree of boxes built with the surface area heuristic (perimeter in 2D) and flattened into one array in
+// depth-first order. Every node stores the index just past its subtree, so a query walks the array front to back
+// without a stack: it steps into a node whose bounds overlap and skips the whole subtree of one that does not.
+// The boxes are reordered so every leaf's boxes sit next to each other. The tree never changes after Build, so
+// any number of threads can query it at once.
+class StaticBvh {
+public:
+    // Build the tree over count boxes, replacing the previous one
+    void Build(const Aabb* boxes, int count);
+
+    bool Empty() const { return nodes.Size() == 0; }
+    int BoxCount() const { return (int)boxes.Size(); }
+    int NodeCount() const { return (int)nodes.Size(); }
+
+    // Call visit(box, index) for every box overlapping the query, index is its position in the input to Build
+    template <typename Visit>
+    void Query(const Aabb& query, Visit&& visit) const {
+        const int count = (int)nodes.Size();
+        int i = 0;
+        while (i < count) {
+            const Node& node = nodes[i];
+            if (!Overlaps(node.bounds, query)) {
+                i = node.skip;
+                continue;
+            }
+            for (int k = node.first; k < node.first + node.count; k++) {
+                if (Overlaps(boxes[k], query)) visit(boxes[k], boxIndex[k]);
+            }
+            i++;
+        }
+    }
+
+    // Push every particle in [begin, end) out of the boxes it overlaps and bounce it off them. Reads only the tree
+    // and writes only the particles in the range, so workers resolve disjoint ranges without locks.
+    void CollideRange(ParticleStore& particles, int begin, int end, float restitution) const;
+
+private:
+    // 32 bytes, two nodes per cache line. Interior nodes have count 0 and their children right after them.
+    struct Node {
+        Aabb bounds;
+        int first; // first box of a leaf
+        int count; // boxes in a leaf, 0 for interior nodes
+        int skip;  // index of the next node after this subtree
+        int unused;
+    };
+
+    int BuildNode(int begin, int end);
+    int Split(int begin, int end, const Aabb& bounds, const Aabb& centroidBounds);
+
+    AlignedArray<Node> nodes;
+    AlignedArray<Aabb> boxes;    // in leaf order
+    AlignedArray<int> boxIndex;  // input index of each box in leaf order
+
+    // Build scratch
+    AlignedArray<Aabb> input;
+    AlignedArray<int> order;
+};
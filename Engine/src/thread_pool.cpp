@@ -0,0 +1,116 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "trace.h"
+
+// Spin this many times before parking, back-to-back frames then skip the wake-up cost
+static const int kSpinCount = 2000;
+
+WorkerPool::WorkerPool(int threadCount) : threadCount(threadCount) {
+    if (this->threadCount <= 0) this->threadCount = (int)std::thread::hardware_concurrency();
+    if (this->threadCount <= 0) this->threadCount = 4; // Default = 4
+    Start(std::vector<int>(this->threadCount, -1));
+}
+
+WorkerPool::WorkerPool(const WorkerPlacement& placement) : threadCount(std::max(placement.ThreadCount(), 1)) {
+    std::vector<int> cpus = placement.cpus;
+    cpus.resize(threadCount, -1);
+    Start(cpus);
+}
+
+void WorkerPool::Start(const std::vector<int>& cpus) {
+    slots = std::vector<WorkerSlot>(threadCount);
+    for (int worker = 1; worker < threadCount; worker++) {
+        slots[worker].thread = std::thread(&WorkerPool::WorkerLoop, this, worker);
+        if (cpus[worker] >= 0 && PinThread(slots[worker].thread, cpus[worker])) slots[worker].cpu = cpus[worker];
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    startCondition.notify_all();
+
+    for (auto& slot : slots) {
+        if (slot.thread.joinable()) slot.thread.join();
+    }
+}
+
+WorkerStats WorkerPool::Stats(int worker) const {
+    return slots[worker].stats;
+}
+
+void WorkerPool::ResetStats() {
+    for (auto& slot : slots) {
+        slot.stats = WorkerStats();
+    }
+}
+
+void WorkerPool::Execute(int worker) {
+    auto startTime = std::chrono::high_resolution_clock::now();
+    jobFunction(jobContext, worker);
+    auto endTime = std::chrono::high_resolution_clock::now();
+
+    WorkerStats& stats = slots[worker].stats;
+    stats.runs++;
+    stats.busyMs += std::chrono::duration<double, std::milli>(endTime - startTime).count();
+}
+
+void WorkerPool::RunJob(JobFunction function, void* context) {
+    if (threadCount == 1) {
+        jobFunction = function;
+        jobContext = context;
+        Execute(0);
+        return;
+    }
+
+    // Start barrier: publish the job and wake every worker
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobFunction = function;
+        jobContext = context;
+        pending.store(threadCount - 1, std::memory_order_relaxed);
+        generation.fetch_add(1, std::memory_order_release);
+    }
+    startCondition.notify_all();
+
+    Execute(0);
+
+    // Finish barrier: spin briefly, then park until the last worker checks in
+    for (int spin = 0; spin < kSpinCount && pending.load(std::memory_order_acquire) != 0; spin++) {
+        CpuRelax();
+    }
+    if (pending.load(std::memory_order_acquire) != 0) {
+        std::unique_lock<std::mutex> lock(mutex);
+        finishCondition.wait(lock, [this] { return pending.load(std::memory_order_acquire) == 0; });
+    }
+}
+
+void WorkerPool::WorkerLoop(int worker) {
+    TRACE_THREAD_NAME("Worker", worker);
+    unsigned int seen = 0;
+
+    while (true) {
+        for (int spin = 0; spin < kSpinCount && generation.load(std::memory_order_acquire) == seen; spin++) {
+            CpuRelax();
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            startCondition.wait(lock, [&] { return stopping || generation.load(std::memory_order_acquire) != seen; });
+            if (stopping) return;
+            seen = generation.load(std::memory_order_acquire);
+        }
+
+        Execute(worker);
+
+        if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::lock_guard<std::mutex> lock(mutex);
+            finishCondition.notify_one();
+        }
+    }
+}
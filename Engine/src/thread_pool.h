@@ -0,0 +1,77 @@
+// Persistent worker threads that run one job per frame behind a start/finish barrier
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "platform.h"
+#include "topology.h"
+
+// Time each worker spent inside jobs since the last ResetStats
+struct WorkerStats {
+    long long runs = 0;
+    double busyMs = 0.0;
+};
+
+class WorkerPool {
+public:
+    // threadCount includes the calling thread, 0 picks hardware_concurrency
+    explicit WorkerPool(int threadCount = 0);
+
+    // One worker per entry of the placement, each pinned to its CPU. Worker 0 is the thread that calls Run, so it
+    // is left as it is.
+    explicit WorkerPool(const WorkerPlacement& placement);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    int ThreadCount() const { return threadCount; }
+
+    // Call job(worker) once on every worker, the caller runs as worker 0.
+    // Returns after every worker has finished, idle workers park until the next Run.
+    template <typename Job>
+    void Run(Job&& job) {
+        using JobType = typename std::remove_reference<Job>::type;
+        RunJob([](void* context, int worker) { (*static_cast<JobType*>(context))(worker); }, &job);
+    }
+
+    // CPU the worker was pinned to, -1 when it is not pinned
+    int Cpu(int worker) const { return slots[worker].cpu; }
+
+    WorkerStats Stats(int worker) const;
+    void ResetStats();
+
+private:
+    using JobFunction = void (*)(void* context, int worker);
+
+    // Padded to a cache line so workers never write to a neighbour's line
+    struct alignas(CACHE_LINE_SIZE) WorkerSlot {
+        std::thread thread;
+        WorkerStats stats;
+        int cpu = -1;
+    };
+
+    void Start(const std::vector<int>& cpus);
+
+    void RunJob(JobFunction function, void* context);
+    void WorkerLoop(int worker);
+    void Execute(int worker);
+
+    int threadCount;
+    std::vector<WorkerSlot> slots;
+
+    std::mutex mutex;
+    std::condition_variable startCondition;
+    std::condition_variable finishCondition;
+    std::atomic<unsigned int> generation{0};
+    std::atomic<int> pending{0};
+    bool stopping = false;
+
+    JobFunction jobFunction = nullptr;
+    void* jobContext = nullptr;
+};
@@ -0,0 +1,265 @@
+#include "topology.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#ifdef __linux__
+// Read a sysfs CPU list such as "0-3,8-11" into its numbers, returns false if the file cannot be read
+static bool ReadCpuList(const char* path, std::vector<int>& values) {
+    values.clear();
+    FILE* file = fopen(path, "r");
+    if (!file) return false;
+
+    char text[4096];
+    bool read = fgets(text, sizeof(text), file) != nullptr;
+    fclose(file);
+    if (!read) return false;
+
+    const char* p = text;
+    while (*p >= '0' && *p <= '9') {
+        char* end = nullptr;
+        int first = (int)strtol(p, &end, 10);
+        int last = first;
+        p = end;
+        if (*p == '-') {
+            last = (int)strtol(p + 1, &end, 10);
+            p = end;
+        }
+        for (int value = first; value <= last; value++) values.push_back(value);
+        if (*p == ',') p++;
+    }
+    return true;
+}
+
+static int ReadInt(const char* path, int fallback) {
+    FILE* file = fopen(path, "r");
+    if (!file) return fallback;
+    int value = fallback;
+    if (fscanf(file, "%d", &value) != 1) value = fallback;
+    fclose(file);
+    return value;
+}
+#endif
+
+CpuTopology CpuTopology::Detect() {
+    CpuTopology topology;
+
+#ifdef __linux__
+    std::vector<int> online;
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (ReadCpuList("/sys/devices/system/cpu/online", online) &&
+        sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+        char path[256];
+        for (int cpu : online) {
+            if (cpu >= CPU_SETSIZE || !CPU_ISSET(cpu, &allowed)) continue;
+            CpuInfo info;
+            info.cpu = cpu;
+            snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/core_id", cpu);
+            info.core = ReadInt(path, cpu);
+            snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu);
+            info.package = ReadInt(path, 0);
+            info.node = 0;
+            info.firstThread = false;
+            topology.cpus.push_back(info);
+        }
+
+        // Machines without NUMA have no node directory, everything stays on node 0
+        std::vector<int> nodes;
+        std::vector<int> nodeCpus;
+        if (ReadCpuList("/sys/devices/system/node/online", nodes)) {
+            for (int node : nodes) {
+                snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+                if (!ReadCpuList(path, nodeCpus)) continue;
+                for (CpuInfo& info : topology.cpus) {
+                    if (std::find(nodeCpus.begin(), nodeCpus.end(), info.cpu) != nodeCpus.end()) info.node = node;
+                }
+            }
+        }
+        topology.fromSysfs = !topology.cpus.empty();
+    }
+#endif
+
+    if (topology.cpus.empty()) {
+        int count = std::max((int)std::thread::hardware_concurrency(), 1);
+        for (int cpu = 0; cpu < count; cpu++) {
+            topology.cpus.push_back({cpu, cpu, 0, 0, false});
+        }
+    }
+
+    // Core ids from sysfs only count within a package, renumber them across the machine
+    std::sort(topology.cpus.begin(), topology.cpus.end(), [](const CpuInfo& a, const CpuInfo& b) {
+        if (a.node != b.node) return a.node < b.node;
+        if (a.package != b.package) return a.package < b.package;
+        if (a.core != b.core) return a.core < b.core;
+        return a.cpu < b.cpu;
+    });
+    int core = -1;
+    for (size_t i = 0; i < topology.cpus.size(); i++) {
+        CpuInfo& info = topology.cpus[i];
+        bool newCore = i == 0 || info.package != topology.cpus[i - 1].package || info.core != topology.cpus[i - 1].core;
+        if (newCore) core++;
+        info.core = core;
+        info.firstThread = newCore;
+        if (i == 0 || info.node != topology.cpus[i - 1].node) topology.nodeCount++;
+    }
+    topology.coreCount = core + 1;
+    return topology;
+}
+
+int CpuTopology::CurrentNode() const {
+#ifdef __linux__
+    int current = sched_getcpu();
+    for (const CpuInfo& info : cpus) {
+        if (info.cpu == current) return info.node;
+    }
+#endif
+    return 0;
+}
+
+bool ParsePlacementPolicy(const char* name, PlacementPolicy& policy) {
+    if (strcmp(name, "none") == 0) {
+        policy = PlacementPolicy::None;
+    } else if (strcmp(name, "physical") == 0) {
+        policy = PlacementPolicy::PhysicalFirst;
+    } else if (strcmp(name, "numa") == 0) {
+        policy = PlacementPolicy::NumaLocal;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* PlacementPolicyName(PlacementPolicy policy) {
+    switch (policy) {
+    case PlacementPolicy::PhysicalFirst: return "physical-first";
+    case PlacementPolicy::NumaLocal: return "numa-local";
+    default: return "none";
+    }
+}
+
+std::string WorkerPlacement::Describe() const {
+    std::string text = PlacementPolicyName(policy);
+    text += ", " + std::to_string(ThreadCount()) + (ThreadCount() == 1 ? " worker" : " workers");
+
+    if (policy == PlacementPolicy::None) {
+        text += " unpinned";
+    } else {
+        text += " on cpus ";
+        std::vector<int> usedNodes;
+        for (int w = 0; w < ThreadCount(); w++) {
+            if (w > 0) text += ",";
+            text += std::to_string(cpus[w]);
+            if (std::find(usedNodes.begin(), usedNodes.end(), nodes[w]) == usedNodes.end()) usedNodes.push_back(nodes[w]);
+        }
+        std::sort(usedNodes.begin(), usedNodes.end());
+        text += usedNodes.size() == 1 ? " (node " : " (nodes ";
+        for (size_t i = 0; i < usedNodes.size(); i++) {
+            if (i > 0) text += ",";
+            text += std::to_string(usedNodes[i]);
+        }
+        text += ")";
+    }
+
+    if (!reserved.empty()) {
+        text += ", " + std::to_string(reserved.size()) + (reserved.size() == 1 ? " cpu reserved" : " cpus reserved");
+    }
+    return text;
+}
+
+WorkerPlacement PlaceWorkers(const CpuTopology& topology, const PlacementConfig& config) {
+    const std::vector<CpuInfo>& cpus = topology.Cpus();
+    WorkerPlacement placement;
+    placement.policy = config.policy;
+
+    // Reserve the cores holding the lowest numbered CPUs, always leaving at least one core for the workers
+    const int reservedCores = std::min(std::max(config.reservedCores, 0), topology.CoreCount() - 1);
+    std::vector<int> coreOrder;
+    for (const CpuInfo& info : cpus) {
+        if (std::find(coreOrder.begin(), coreOrder.end(), info.core) == coreOrder.end()) coreOrder.push_back(info.core);
+    }
+    std::sort(coreOrder.begin(), coreOrder.end(), [&](int a, int b) {
+        int lowestA = INT_MAX;
+        int lowestB = INT_MAX;
+        for (const CpuInfo& info : cpus) {
+            if (info.core == a) lowestA = std::min(lowestA, info.cpu);
+            if (info.core == b) lowestB = std::min(lowestB, info.cpu);
+        }
+        return lowestA < lowestB;
+    });
+    auto isReserved = [&](const CpuInfo& info) {
+        return std::find(coreOrder.begin(), coreOrder.begin() + reservedCores, info.core) != coreOrder.begin() + reservedCores;
+    };
+    for (const CpuInfo& info : cpus) {
+        if (isReserved(info)) placement.reserved.push_back(info.cpu);
+    }
+
+    // Physical cores first, then their SMT siblings, in node and core order
+    std::vector<const CpuInfo*> candidates;
+    const int node = config.node >= 0 ? config.node : topology.CurrentNode();
+    for (int pass = 0; pass < 2; pass++) {
+        for (const CpuInfo& info : cpus) {
+            if (info.firstThread != (pass == 0) || isReserved(info)) continue;
+            if (config.policy == PlacementPolicy::NumaLocal && info.node != node) continue;
+            candidates.push_back(&info);
+        }
+    }
+
+    // Nothing to pin to, such as a node without CPUs left, runs unpinned
+    if (candidates.empty()) placement.policy = PlacementPolicy::None;
+
+    int threads = config.threads;
+    if (threads <= 0) {
+        threads = placement.policy == PlacementPolicy::None ? topology.CpuCount() - (int)placement.reserved.size()
+                                                            : (int)candidates.size();
+    }
+    threads = std::max(threads, 1);
+
+    for (int w = 0; w < threads; w++) {
+        if (placement.policy == PlacementPolicy::None) {
+            placement.cpus.push_back(-1);
+            placement.nodes.push_back(-1);
+        } else {
+            const CpuInfo* info = candidates[w % candidates.size()];
+            placement.cpus.push_back(info->cpu);
+            placement.nodes.push_back(info->node);
+        }
+    }
+    return placement;
+}
+
+#ifdef __linux__
+static bool PinNativeThread(pthread_t thread, int cpu) {
+    if (cpu < 0 || cpu >= CPU_SETSIZE) return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(thread, sizeof(set), &set) == 0;
+}
+#endif
+
+bool PinThread(std::thread& thread, int cpu) {
+#ifdef __linux__
+    return PinNativeThread(thread.native_handle(), cpu);
+#else
+    (void)thread;
+    (void)cpu;
+    return false;
+#endif
+}
+
+bool PinCurrentThread(int cpu) {
+#ifdef __linux__
+    return PinNativeThread(pthread_self(), cpu);
+#else
+    (void)cpu;
+    return false;
+#endif
+}
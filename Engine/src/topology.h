@@ -0,0 +1,79 @@
+// CPU layout of the machine and where the workers go on it
+#pragma once
+
+#include <string>
+#include <thread>
+#include <vector>
+
+// One logical CPU the process may run on
+struct CpuInfo {
+    int cpu;          // logical CPU number, what affinity masks use
+    int core;         // physical core, numbered across the whole machine
+    int package;      // socket
+    int node;         // NUMA node
+    bool firstThread; // lowest numbered SMT sibling of its core
+};
+
+// The logical CPUs this process may use, read from Linux sysfs (/sys/devices/system/cpu and
+// /sys/devices/system/node) and the process affinity mask. Where sysfs cannot be read, such as on Windows, every
+// CPU std::thread reports is its own core on node 0.
+class CpuTopology {
+public:
+    static CpuTopology Detect();
+
+    // Ordered by node, then core, then SMT sibling
+    const std::vector<CpuInfo>& Cpus() const { return cpus; }
+    int CpuCount() const { return (int)cpus.size(); }
+    int CoreCount() const { return coreCount; }
+    int NodeCount() const { return nodeCount; }
+    bool FromSysfs() const { return fromSysfs; }
+
+    // Node of the CPU the calling thread is on right now, 0 when unknown
+    int CurrentNode() const;
+
+private:
+    std::vector<CpuInfo> cpus;
+    int coreCount = 0;
+    int nodeCount = 0;
+    bool fromSysfs = false;
+};
+
+// How workers are pinned
+enum class PlacementPolicy {
+    None,          // not pinned, the OS places them
+    PhysicalFirst, // one worker per physical core, node by node, before any SMT sibling
+    NumaLocal      // only the CPUs of one node, physical cores first
+};
+
+// Parse "none", "physical" or "numa", returns false on an unknown name
+bool ParsePlacementPolicy(const char* name, PlacementPolicy& policy);
+const char* PlacementPolicyName(PlacementPolicy policy);
+
+struct PlacementConfig {
+    PlacementPolicy policy = PlacementPolicy::None;
+    int threads = 0;       // workers including the calling thread, 0 is one per CPU left after the reserved cores
+    int reservedCores = 0; // physical cores, with their SMT siblings, that no worker is pinned to
+    int node = -1;         // node for NumaLocal, -1 is the node the calling thread runs on
+};
+
+// CPU of every worker, -1 leaves it unpinned. Worker 0 is whichever thread calls WorkerPool::Run, so the pool never
+// pins it. Callers that always run the pool from the same thread pin that thread to cpus[0] themselves.
+struct WorkerPlacement {
+    PlacementPolicy policy = PlacementPolicy::None;
+    std::vector<int> cpus;
+    std::vector<int> nodes;    // node of each worker's CPU, -1 when unpinned
+    std::vector<int> reserved; // CPUs kept free
+
+    int ThreadCount() const { return (int)cpus.size(); }
+
+    // One line such as "physical-first, 4 workers on cpus 0,2,4,6 (node 0), 2 cpus reserved"
+    std::string Describe() const;
+};
+
+// Pick a CPU for every worker. The reserved cores are the lowest numbered ones, where the main thread and the
+// interrupt handlers usually run. Asking for more workers than there are CPUs left wraps around them.
+WorkerPlacement PlaceWorkers(const CpuTopology& topology, const PlacementConfig& config);
+
+// Pin a thread to one CPU, returns false where affinity is not supported or the CPU is not allowed
+bool PinThread(std::thread& thread, int cpu);
+bool PinCurrentThread(int cpu);
@@ -0,0 +1,103 @@
+#include "trace.h"
+
+#include <atomic>
+#include <cstdio>
+
+#include "platform.h"
+
+struct TraceEvent {
+    const char* name;
+    uint64_t start;
+    uint64_t end;
+};
+
+// Written only by its own thread. The head is published with release so a reader that loads it with acquire
+// sees every event before it.
+struct alignas(CACHE_LINE_SIZE) TraceRing {
+    std::atomic<uint64_t> head{0};
+    char name[32] = {};
+    TraceEvent events[TRACE_RING_CAPACITY];
+};
+
+static_assert((TRACE_RING_CAPACITY & (TRACE_RING_CAPACITY - 1)) == 0, "ring capacity must be a power of two");
+
+// Rings are never freed, a worker that exits before the trace is written still shows up in it
+static std::atomic<TraceRing*> rings[TRACE_MAX_THREADS];
+static std::atomic<int> ringCount{0};
+
+// Timestamps in the file are relative to when the program started
+static const uint64_t kEpoch = TraceNow();
+
+static thread_local TraceRing* threadRing = nullptr;
+static thread_local bool threadDropped = false;
+
+static TraceRing* ThreadRing() {
+    if (threadRing || threadDropped) return threadRing;
+
+    int slot = ringCount.fetch_add(1, std::memory_order_relaxed);
+    if (slot >= TRACE_MAX_THREADS) {
+        threadDropped = true;
+        return nullptr;
+    }
+    threadRing = new TraceRing();
+    rings[slot].store(threadRing, std::memory_order_release);
+    return threadRing;
+}
+
+void TraceRecord(const char* name, uint64_t startNs, uint64_t endNs) {
+    TraceRing* ring = ThreadRing();
+    if (!ring) return;
+
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    ring->events[head & (TRACE_RING_CAPACITY - 1)] = {name, startNs, endNs};
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+void TraceSetThreadName(const char* name, int number) {
+    TraceRing* ring = ThreadRing();
+    if (!ring) return;
+
+    if (number >= 0) {
+        snprintf(ring->name, sizeof(ring->name), "%s %d", name, number);
+    } else {
+        snprintf(ring->name, sizeof(ring->name), "%s", name);
+    }
+}
+
+bool WriteChromeTrace(const char* path) {
+    FILE* file = fopen(path, "w");
+    if (!file) return false;
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+
+    int count = ringCount.load(std::memory_order_acquire);
+    if (count > TRACE_MAX_THREADS) count = TRACE_MAX_THREADS;
+
+    for (int tid = 0; tid < count; tid++) {
+        const TraceRing* ring = rings[tid].load(std::memory_order_acquire);
+        if (!ring) continue;
+
+        // Thread names label the timeline rows
+        char fallback[32];
+        snprintf(fallback, sizeof(fallback), "Thread %d", tid);
+        const char* name = ring->name[0] ? ring->name : fallback;
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                first ? "" : ",\n", tid, name);
+        first = false;
+
+        // Complete events, microseconds since the program started
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        uint64_t begin = head > TRACE_RING_CAPACITY ? head - TRACE_RING_CAPACITY : 0;
+        for (uint64_t i = begin; i < head; i++) {
+            const TraceEvent& event = ring->events[i & (TRACE_RING_CAPACITY - 1)];
+            double ts = (double)(int64_t)(event.start - kEpoch) / 1000.0;
+            double dur = (double)(event.end - event.start) / 1000.0;
+            fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                    event.name, tid, ts, dur);
+        }
+    }
+
+    fprintf(file, "\n]}\n");
+    return fclose(file) == 0;
+}
@@ -0,0 +1,62 @@
+// Scoped trace zones recorded per thread and written out as Chrome trace JSON
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+// Build with -DPHYSICS_TRACE (make TRACE=1) to record zones. Without it TRACE_ZONE and TRACE_THREAD_NAME
+// compile to nothing, so the zones can stay in the hot paths.
+#ifdef PHYSICS_TRACE
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_ZONE(name) TraceZone TRACE_CONCAT(traceZone, __LINE__)(name)
+#define TRACE_THREAD_NAME(...) TraceSetThreadName(__VA_ARGS__)
+#else
+#define TRACE_ZONE(name) do {} while (0)
+#define TRACE_THREAD_NAME(...) do {} while (0)
+#endif
+
+// Events each thread keeps, older ones are overwritten once a thread has recorded more
+#define TRACE_RING_CAPACITY (1 << 16)
+
+// Threads that can record, later threads are ignored
+#define TRACE_MAX_THREADS 64
+
+// Whether zones in the calling file are recorded
+constexpr bool TraceEnabled() {
+#ifdef PHYSICS_TRACE
+    return true;
+#else
+    return false;
+#endif
+}
+
+inline uint64_t TraceNow() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Record one finished zone on the calling thread's ring. Name must outlive the trace, zones use string literals.
+void TraceRecord(const char* name, uint64_t startNs, uint64_t endNs);
+
+// Name the calling thread in the trace, number is appended when not negative ("Worker 3")
+void TraceSetThreadName(const char* name, int number = -1);
+
+// Write every recorded zone as Chrome trace JSON, which Perfetto (ui.perfetto.dev) and chrome://tracing open.
+// Rings are read without locks, so call this while no thread is recording. Returns false if the file could not
+// be written.
+bool WriteChromeTrace(const char* path);
+
+// Measures from construction to the end of the scope
+class TraceZone {
+public:
+    explicit TraceZone(const char* name) : name(name), start(TraceNow()) {}
+    ~TraceZone() { TraceRecord(name, start, TraceNow()); }
+
+    TraceZone(const TraceZone&) = delete;
+    TraceZone& operator=(const TraceZone&) = delete;
+
+private:
+    const char* name;
+    uint64_t start;
+};
@@ -0,0 +1,679 @@
+#include "world.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#include "scheduler.h"
+#include "trace.h"
+
+// Player keeps this far from both walls
+static const float kGameWallMargin = 50.0f;
+
+// Rain drops respawn just above the top edge
+static const float kRainRespawnY = -10.0f;
+
+// Particles copied per snapshot task, large since a copy is cheaper than a task
+static const int kSnapshotGrain = 16384;
+
+// Drops integrated per rain kernel call, bounds the respawn index buffer
+static const int kRainBlock = 1024;
+
+// Emitted particles filled per scheduler task, smaller emissions are filled on the calling thread
+static const int kEmitGrain = 4096;
+
+// Particles whose still counters are updated per scheduler task, the loop is short
+static const int kSleepGrain = 16384;
+
+// Share of sliding the position-based solver removes at contacts and on the floor, so piles keep their shape
+static const float kXpbdFriction = 0.2f;
+
+// Fastest the position-based solver pushes particles out of an overlap, well under the sleep speed so a settled
+// pile stays asleep
+static const float kXpbdDepenetration = 1.0f;
+
+static double MsSince(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+PhaseTimings operator-(const PhaseTimings& a, const PhaseTimings& b) {
+    PhaseTimings result;
+    result.steps = a.steps - b.steps;
+    result.updateMs = a.updateMs - b.updateMs;
+    result.broadPhaseMs = a.broadPhaseMs - b.broadPhaseMs;
+    result.narrowPhaseMs = a.narrowPhaseMs - b.narrowPhaseMs;
+    result.snapshotMs = a.snapshotMs - b.snapshotMs;
+    return result;
+}
+
+WorldConfig DefaultConfig(Scenario scenario) {
+    WorldConfig config;
+    config.scenario = scenario;
+
+    switch (scenario) {
+    case Scenario::Bounce:
+        config.width = 800.0f;
+        config.height = 600.0f;
+        config.particleCount = 10000;
+        break;
+    case Scenario::Rain:
+        config.width = 800.0f;
+        config.height = 600.0f;
+        config.particleCount = 25000;
+        break;
+    case Scenario::Game:
+        config.width = 1280.0f;
+        config.height = 800.0f;
+        config.particleCount = 50;
+        // Particles resting in a pile keep a couple of pixels per frame of jitter from gravity and the contact
+        // pushes, a bouncing particle is only that slow for a few frames at the top of its arc
+        config.sleepSteps = 30;
+        config.sleepSpeed = 3.0f;
+        break;
+    }
+    return config;
+}
+
+WorldConfig PileGameConfig(int particleCount) {
+    WorldConfig config = DefaultConfig(Scenario::Game);
+    config.particleCount = particleCount;
+    config.radiusScale = 0.25f;
+    config.collisions = true;
+
+    // The impulse solver lets piles this deep sink into each other
+    config.solver = SolverType::Xpbd;
+    config.substeps = 4;
+
+    // Two staggered rows of ledges
+    for (int i = 0; i < 8; i++) {
+        float x = 60.0f + i * 150.0f;
+        float y = (i % 2 == 0) ? 350.0f : 500.0f;
+        config.platforms.push_back({x, y, x + 120.0f, y + 10.0f});
+    }
+    return config;
+}
+
+bool ParseScenario(const char* name, Scenario& scenario) {
+    if (strcmp(name, "bounce") == 0) scenario = Scenario::Bounce;
+    else if (strcmp(name, "rain") == 0) scenario = Scenario::Rain;
+    else if (strcmp(name, "game") == 0) scenario = Scenario::Game;
+    else return false;
+    return true;
+}
+
+const char* ScenarioName(Scenario scenario) {
+    switch (scenario) {
+    case Scenario::Bounce: return "bounce";
+    case Scenario::Rain: return "rain";
+    case Scenario::Game: return "game";
+    }
+    return "unknown";
+}
+
+World::World(const WorldConfig& config) : config(config), kernels(&SelectKernels(config.simd)) {
+    Reset();
+}
+
+World::World(const WorldConfig& config, TaskScheduler& scheduler)
+    : config(config), kernels(&SelectKernels(config.simd)) {
+    Reset(scheduler);
+}
+
+void World::Reset() {
+    ResetState();
+    SpawnRange(0, particles.Size());
+}
+
+void World::Reset(TaskScheduler& scheduler) {
+    ResetState();
+    FirstTouch(scheduler);
+    scheduler.ParallelFor(0, particles.Size(), config.grainSize, [&](int begin, int end, int) {
+        SpawnRange(begin, end);
+    });
+}
+
+void World::ResetState() {
+    random = CounterRandom(config.seed);
+    stepCount = 0;
+
+    player = PlayerState();
+    player.x = config.width / 2;
+    player.y = config.height - player.height;
+
+    pool.Reset(particles, config.particleCount, std::max(config.capacity, config.particleCount));
+    pool.ReserveWorkers(1);
+    emitters = config.emitters;
+    level.Build(config.platforms.data(), (int)config.platforms.size());
+
+    awake = particles.Size();
+    sleepChanged = false;
+    partitionLayout = particles.layout;
+    partitionSize = particles.Size();
+}
+
+// Same split as the shares TaskScheduler::Run seeds the deques with, the last worker also takes the spare capacity
+// that emitters fill later
+void World::FirstTouch(TaskScheduler& scheduler) {
+    const int workers = scheduler.WorkerCount();
+    if (workers == 1) return;
+
+    const int count = particles.Size();
+    const int capacity = (int)particles.x.Capacity();
+    const int share = (count + workers - 1) / workers;
+    scheduler.Pool().Run([&](int worker) {
+        int begin = std::min(worker * share, count);
+        int end = worker == workers - 1 ? capacity : std::min(begin + share, count);
+        particles.Touch(begin, end);
+    });
+}
+
+// Every particle draws from its own counters, so any split of the range spawns the same particles
+void World::SpawnRange(int begin, int end) {
+    const int width = (int)config.width;
+    const int height = (int)config.height;
+
+    for (int i = begin; i < end; i++) {
+        RandomBlock a = random.Block(RandomStream::Spawn, i, 0, 0);
+        RandomBlock b = random.Block(RandomStream::Spawn, i, 0, 1);
+
+        Particle p;
+        switch (config.scenario) {
+        case Scenario::Bounce:
+            p.position = {(float)RandomRange(a.word[0], 0, width), (float)RandomRange(a.word[1], 0, height)};
+            p.velocity = {(float)RandomRange(a.word[2], -200, 200) / 100.0f, (float)RandomRange(a.word[3], -200, 200) / 100.0f};
+            p.radius = (float)RandomRange(b.word[0], 2, 5) * config.radiusScale;
+            p.color = {(unsigned char)RandomRange(b.word[1], 50, 255), (unsigned char)RandomRange(b.word[2], 50, 255), (unsigned char)RandomRange(b.word[3], 50, 255), 255};
+            break;
+        case Scenario::Rain:
+            p.position = {(float)RandomRange(a.word[0], 0, width - 1), (float)RandomRange(a.word[1], 0, height - 1)};
+            p.velocity = {0.0f, 300.0f + RandomRange(a.word[2], 0, 199)};
+            p.radius = 0.0f;
+            p.color = {0, 121, 241, 255};
+            break;
+        case Scenario::Game:
+            p.position = {(float)RandomRange(a.word[0], 0, width - 1), 200.0f + RandomRange(a.word[1], 0, height - 1)};
+            p.velocity = {(float)RandomRange(a.word[2], 0, 4), (float)RandomRange(a.word[3], 0, 4)};
+            p.radius = (5.0f + RandomRange(b.word[0], 0, 14)) * config.radiusScale;
+            p.color = {0, 121, 241, 255};
+            break;
+        }
+        particles.Set(i, p);
+    }
+}
+
+// Player movement from Main Game, keeps a margin from both walls. Returns whether the player moved.
+bool World::UpdatePlayer() {
+    const float startX = player.x;
+    if (player.input < 0 && player.x >= kGameWallMargin) {
+        player.x -= player.speed;
+    }
+    if (player.input > 0 && player.x + player.width <= config.width - kGameWallMargin) {
+        player.x += player.speed;
+    }
+    return player.x != startX;
+}
+
+// Both keep the awake particles in front of the sleeping ones, so the partition holds between steps
+ParticleHandle World::Spawn(const Particle& p) {
+    ParticleHandle handle = pool.Spawn(particles, p);
+    if (!handle.Valid() || config.sleepSteps <= 0) return handle;
+
+    int index = pool.IndexOf(handle);
+    if (particles.still[index] >= config.sleepSteps) return handle;
+    pool.SwapIndices(particles, index, awake);
+    awake++;
+    partitionLayout = particles.layout;
+    partitionSize = particles.Size();
+    return handle;
+}
+
+bool World::Despawn(ParticleHandle handle) {
+    int index = pool.IndexOf(handle);
+    if (index < 0) return false;
+
+    if (config.sleepSteps > 0) {
+        // Move the particle to the end of the store first, through the boundary if it is awake
+        if (index < awake) {
+            awake--;
+            pool.SwapIndices(particles, index, awake);
+            index = awake;
+        }
+        pool.SwapIndices(particles, index, particles.Size() - 1);
+    }
+    pool.Despawn(particles, handle);
+    partitionLayout = particles.layout;
+    partitionSize = particles.Size();
+    return true;
+}
+
+void World::Step(float dt) {
+    TRACE_ZONE("Step");
+    BeginStep(nullptr);
+    Integrate(dt, nullptr);
+    BroadPhase(nullptr);
+    NarrowPhase(nullptr);
+    EndStep(dt, nullptr);
+}
+
+void World::Step(float dt, TaskScheduler& scheduler) {
+    TRACE_ZONE("Step");
+    BeginStep(&scheduler);
+    Integrate(dt, &scheduler);
+    BroadPhase(&scheduler);
+    NarrowPhase(&scheduler);
+    EndStep(dt, &scheduler);
+}
+
+// Moves the player and remembers where it started, the later phases of the step need both
+void World::BeginStep(TaskScheduler* scheduler) {
+    stepPlayerStartX = player.x;
+    stepPlayerMoved = false;
+    if (config.scenario == Scenario::Game) {
+        stepPlayerMoved = UpdatePlayer();
+    }
+    if (scheduler) pool.ReserveWorkers(scheduler->WorkerCount());
+}
+
+void World::Integrate(float dt, TaskScheduler* scheduler) {
+    if (UsesXpbd()) {
+        StepXpbd(dt, stepPlayerStartX, scheduler);
+        return;
+    }
+
+    auto updateStart = std::chrono::high_resolution_clock::now();
+    const int active = AwakeCount();
+    if (scheduler) {
+        // Every frame is exactly one step, the scheduler balances the ranges between workers
+        scheduler->ParallelFor(0, active, config.grainSize, [&](int begin, int end, int) {
+            UpdateRange(begin, end, dt);
+        });
+        if (pool.HasMortal() && active < particles.Size()) {
+            scheduler->ParallelFor(active, particles.Size(), kSleepGrain, [&](int begin, int end, int) {
+                AgeRange(begin, end, dt);
+            });
+        }
+    } else {
+        UpdateRange(0, active, dt);
+        if (pool.HasMortal()) {
+            AgeRange(active, particles.Size(), dt);
+        }
+    }
+    timings.updateMs += MsSince(updateStart);
+}
+
+void World::EndStep(float dt, TaskScheduler* scheduler) {
+    Sleep(stepPlayerMoved, scheduler);
+    Lifecycle(dt, scheduler);
+    PartitionAwake();
+    stepCount++;
+    timings.steps++;
+}
+
+int World::AddEmitter(const Emitter& emitter) {
+    emitters.push_back(emitter);
+    return (int)emitters.size() - 1;
+}
+
+// Particles whose life ran out leave, emitters add new ones and then the spawns and despawns queued during the
+// step are applied, all after every worker has finished with the particles
+void World::Lifecycle(float dt, TaskScheduler* scheduler) {
+    TRACE_ZONE("Lifecycle");
+    if (pool.HasMortal()) {
+        if (scheduler) {
+            pool.RemoveDead(particles, *scheduler);
+        } else {
+            pool.RemoveDead(particles);
+        }
+    }
+    Emit(dt, scheduler);
+    pool.Flush(particles);
+}
+
+// Emitted particles draw by emission number, emitter and step, so they come out the same on any worker
+void World::Emit(float dt, TaskScheduler* scheduler) {
+    for (int e = 0; e < (int)emitters.size(); e++) {
+        Emitter& emitter = emitters[e];
+        int first = 0;
+        int count = pool.SpawnBlock(particles, EmitCount(emitter, dt), first);
+        if (count == 0) continue;
+
+        auto fill = [&](int begin, int end) {
+            for (int k = begin; k < end; k++) {
+                RandomBlock a = random.Block(RandomStream::Emit, k, (uint64_t)stepCount, 2 * e);
+                RandomBlock b = random.Block(RandomStream::Emit, k, (uint64_t)stepCount, 2 * e + 1);
+                particles.Set(first + k, EmitParticle(emitter, a, b));
+            }
+        };
+        if (scheduler && count > kEmitGrain) {
+            scheduler->ParallelFor(0, count, kEmitGrain, [&](int begin, int end, int) { fill(begin, end); });
+        } else {
+            fill(0, count);
+        }
+    }
+}
+
+void World::AgeRange(int begin, int end, float dt) {
+    float* life = particles.life.Data();
+    for (int i = begin; i < end; i++) life[i] -= dt;
+}
+
+// Cells one largest diameter wide keep every overlapping pair in neighbouring cells
+void World::BroadPhase(TaskScheduler* scheduler) {
+    if (!config.collisions || UsesXpbd()) return;
+
+    auto broadStart = std::chrono::high_resolution_clock::now();
+    float minCellSize = 2.0f * MaxRadius(particles);
+    if (scheduler) {
+        grid.Build(particles, config.width, config.height, minCellSize, *scheduler);
+    } else {
+        grid.Build(particles, config.width, config.height, minCellSize);
+    }
+    timings.broadPhaseMs += MsSince(broadStart);
+}
+
+void World::NarrowPhase(TaskScheduler* scheduler) {
+    if (!config.collisions || UsesXpbd()) return;
+
+    auto narrowStart = std::chrono::high_resolution_clock::now();
+    if (scheduler) {
+        solver.Solve(particles, grid, config.restitution, AwakeCount(), config.sleepSpeed, *scheduler);
+    } else {
+        solver.Solve(particles, grid, config.restitution, AwakeCount(), config.sleepSpeed);
+    }
+    timings.narrowPhaseMs += MsSince(narrowStart);
+}
+
+// Substeps of the position-based solver in place of the update kernel and the impulse solve. The player slides
+// from where it started the step to where it ended so it pushes particles a little every substep.
+void World::StepXpbd(float dt, float playerStartX, TaskScheduler* scheduler) {
+    TRACE_ZONE("Xpbd");
+    const int substeps = std::max(config.substeps, 1);
+    const float ticks = dt * GAME_TICK_RATE;
+
+    XpbdParams params;
+    params.h = ticks / substeps;
+    params.gravity = GAME_GRAVITY;
+    params.drag = GameDrag(params.h);
+    params.maxSpeed = GAME_SPEED_CAP;
+    params.compliance = config.compliance;
+    params.friction = kXpbdFriction;
+    params.width = config.width;
+    params.height = config.height;
+    params.player = {playerStartX, player.y, player.width, player.height, player.speed, player.input};
+    params.level = level.Empty() ? nullptr : &level;
+    params.awake = AwakeCount();
+    params.wakeSpeed = config.sleepSpeed;
+    params.playerMove = (player.x - playerStartX) / (float)substeps;
+    params.depenetrationSpeed = kXpbdDepenetration;
+
+    xpbd.Begin(particles.Size(), scheduler ? scheduler->WorkerCount() : 1);
+    const float minCellSize = config.collisions ? 2.0f * MaxRadius(particles) : 0.0f;
+
+    for (int s = 0; s < substeps; s++) {
+        params.player.x = playerStartX + (player.x - playerStartX) * (float)(s + 1) / (float)substeps;
+
+        auto updateStart = std::chrono::high_resolution_clock::now();
+        if (scheduler) {
+            xpbd.Predict(particles, params, *scheduler);
+        } else {
+            xpbd.Predict(particles, params);
+        }
+        timings.updateMs += MsSince(updateStart);
+
+        const SpatialGrid* contacts = nullptr;
+        if (config.collisions) {
+            auto broadStart = std::chrono::high_resolution_clock::now();
+            if (scheduler) {
+                grid.Build(particles, config.width, config.height, minCellSize, *scheduler);
+            } else {
+                grid.Build(particles, config.width, config.height, minCellSize);
+            }
+            contacts = &grid;
+            timings.broadPhaseMs += MsSince(broadStart);
+        }
+
+        auto narrowStart = std::chrono::high_resolution_clock::now();
+        if (scheduler) {
+            xpbd.Project(particles, contacts, params, *scheduler);
+        } else {
+            xpbd.Project(particles, contacts, params);
+        }
+        timings.narrowPhaseMs += MsSince(narrowStart);
+    }
+
+    if (pool.HasMortal()) {
+        if (scheduler) {
+            scheduler->ParallelFor(0, particles.Size(), kSleepGrain, [&](int begin, int end, int) {
+                AgeRange(begin, end, dt);
+            });
+        } else {
+            AgeRange(0, particles.Size(), dt);
+        }
+    }
+}
+
+int World::ContactCount() const {
+    if (!config.collisions) return 0;
+    return UsesXpbd() ? xpbd.ContactCount() : solver.ContactCount();
+}
+
+// Count steps below the sleep speed and put particles to sleep, then wake the sleeping particles that were hit by
+// a moving particle or the player. Which particles sleep only depends on their own state and the contacts, the
+// partition after the lifecycle does the moving.
+void World::Sleep(bool playerMoved, TaskScheduler* scheduler) {
+    if (config.sleepSteps <= 0) return;
+    TRACE_ZONE("Sleep");
+
+    int fellAsleep = 0;
+    int woke = 0;
+    if (scheduler) {
+        std::atomic<int> fell(0);
+        scheduler->ParallelFor(0, awake, kSleepGrain, [&](int begin, int end, int) {
+            fell.fetch_add(SettleRange(begin, end), std::memory_order_relaxed);
+        });
+        fellAsleep = fell.load();
+    } else {
+        fellAsleep = SettleRange(0, awake);
+    }
+
+    if (config.collisions) {
+        const bool positionBased = UsesXpbd();
+        const int workers = positionBased ? xpbd.WorkerCount() : solver.WorkerCount();
+        for (int w = 0; w < workers; w++) {
+            const int* woken = positionBased ? xpbd.Woken(w) : solver.Woken(w);
+            const int count = positionBased ? xpbd.WokenCount(w) : solver.WokenCount(w);
+            for (int k = 0; k < count; k++) particles.still[woken[k]] = 0;
+            woke += count;
+        }
+    }
+
+    if (playerMoved) {
+        if (scheduler) {
+            std::atomic<int> near(0);
+            scheduler->ParallelFor(awake, particles.Size(), kSleepGrain, [&](int begin, int end, int) {
+                near.fetch_add(WakeNearPlayer(begin, end), std::memory_order_relaxed);
+            });
+            woke += near.load();
+        } else {
+            woke += WakeNearPlayer(awake, particles.Size());
+        }
+    }
+    sleepChanged = fellAsleep > 0 || woke > 0;
+}
+
+// Returns how many particles fell asleep, their velocity is dropped so they wake up at rest
+int World::SettleRange(int begin, int end) {
+    const float limit = config.sleepSpeed * config.sleepSpeed;
+    const uint16_t steps = (uint16_t)config.sleepSteps;
+    float* vx = particles.vx.Data();
+    float* vy = particles.vy.Data();
+    uint16_t* still = particles.still.Data();
+
+    int fellAsleep = 0;
+    for (int i = begin; i < end; i++) {
+        if (vx[i] * vx[i] + vy[i] * vy[i] >= limit) {
+            still[i] = 0;
+            continue;
+        }
+        if (++still[i] == steps) {
+            vx[i] = 0.0f;
+            vy[i] = 0.0f;
+            fellAsleep++;
+        }
+    }
+    return fellAsleep;
+}
+
+// Wakes every sleeping particle whose bounding box touches the player, returns how many
+int World::WakeNearPlayer(int begin, int end) {
+    const float* x = particles.x.Data();
+    const float* y = particles.y.Data();
+    const float* radius = particles.radius.Data();
+    uint16_t* still = particles.still.Data();
+
+    int woke = 0;
+    for (int i = begin; i < end; i++) {
+        const float r = radius[i];
+        if (x[i] + r < player.x || x[i] - r > player.x + player.width) continue;
+        if (y[i] + r < player.y || y[i] - r > player.y + player.height) continue;
+        still[i] = 0;
+        woke++;
+    }
+    return woke;
+}
+
+// Swap sleeping particles behind awake ones from both ends of the store. Runs serially at the end of the step so
+// the layout only depends on the state. Skipped when nothing fell asleep, woke, spawned or despawned.
+void World::PartitionAwake() {
+    if (config.sleepSteps <= 0) return;
+    if (!sleepChanged && partitionLayout == particles.layout && partitionSize == particles.Size()) return;
+    TRACE_ZONE("Sleep Partition");
+
+    const uint16_t steps = (uint16_t)config.sleepSteps;
+    const uint16_t* still = particles.still.Data();
+    int front = 0;
+    int back = particles.Size() - 1;
+    while (true) {
+        while (front <= back && still[front] < steps) front++;
+        while (front <= back && still[back] >= steps) back--;
+        if (front >= back) break;
+        pool.SwapIndices(particles, front, back);
+        front++;
+        back--;
+    }
+
+    awake = front;
+    sleepChanged = false;
+    partitionLayout = particles.layout;
+    partitionSize = particles.Size();
+}
+
+void World::WriteSnapshot(RenderSnapshot& snapshot) const {
+    TRACE_ZONE("Snapshot");
+    auto snapshotStart = std::chrono::high_resolution_clock::now();
+    snapshot.x.Resize(particles.Size());
+    snapshot.y.Resize(particles.Size());
+    snapshot.radius.Resize(particles.Size());
+    snapshot.color.Resize(particles.Size());
+    CopySnapshotRange(snapshot, 0, particles.Size());
+    snapshot.player = player;
+    snapshot.step = stepCount;
+    snapshot.layout = particles.layout;
+    timings.snapshotMs += MsSince(snapshotStart);
+}
+
+void World::WriteSnapshot(RenderSnapshot& snapshot, TaskScheduler& scheduler) const {
+    TRACE_ZONE("Snapshot");
+    auto snapshotStart = std::chrono::high_resolution_clock::now();
+    snapshot.x.Resize(particles.Size());
+    snapshot.y.Resize(particles.Size());
+    snapshot.radius.Resize(particles.Size());
+    snapshot.color.Resize(particles.Size());
+    scheduler.ParallelFor(0, particles.Size(), kSnapshotGrain, [&](int begin, int end, int) {
+        CopySnapshotRange(snapshot, begin, end);
+    });
+    snapshot.player = player;
+    snapshot.step = stepCount;
+    snapshot.layout = particles.layout;
+    timings.snapshotMs += MsSince(snapshotStart);
+}
+
+void World::CopySnapshotRange(RenderSnapshot& snapshot, int begin, int end) const {
+    TRACE_ZONE("Snapshot Copy");
+    const size_t count = end - begin;
+    memcpy(snapshot.x.Data() + begin, particles.x.Data() + begin, count * sizeof(float));
+    memcpy(snapshot.y.Data() + begin, particles.y.Data() + begin, count * sizeof(float));
+    memcpy(snapshot.radius.Data() + begin, particles.radius.Data() + begin, count * sizeof(float));
+    memcpy(snapshot.color.Data() + begin, particles.color.Data() + begin, count * sizeof(Rgba));
+}
+
+uint64_t World::StateHash() {
+    TRACE_ZONE("State Hash");
+    return HashRest(hasher.Hash(particles));
+}
+
+uint64_t World::StateHash(TaskScheduler& scheduler) {
+    TRACE_ZONE("State Hash");
+    return HashRest(hasher.Hash(particles, scheduler));
+}
+
+uint64_t World::HashRest(uint64_t particleHash) const {
+    uint32_t playerBits[2];
+    memcpy(&playerBits[0], &player.x, sizeof(float));
+    memcpy(&playerBits[1], &player.y, sizeof(float));
+
+    uint64_t h = HashCombine(particleHash, (uint64_t)stepCount);
+    return HashCombine(h, ((uint64_t)playerBits[0] << 32) | playerBits[1]);
+}
+
+void World::UpdateRange(int begin, int end, float dt) {
+    TRACE_ZONE("Update");
+    KernelArgs args;
+    args.x = particles.x.Data();
+    args.y = particles.y.Data();
+    args.vx = particles.vx.Data();
+    args.vy = particles.vy.Data();
+    args.radius = particles.radius.Data();
+    args.width = config.width;
+    args.height = config.height;
+    args.dt = dt;
+
+    switch (config.scenario) {
+    case Scenario::Bounce:
+        kernels->bounce(args, begin, end);
+        break;
+
+    case Scenario::Rain: {
+        // Respawned drops draw by index and step, so the new column does not depend on which worker ran them
+        int respawned[kRainBlock];
+        RandomBlock blocks[kRainBlock];
+        for (int first = begin; first < end; first += kRainBlock) {
+            int last = std::min(first + kRainBlock, end);
+            int count = kernels->rain(args, first, last, respawned);
+            random.FillBlocks(RandomStream::Respawn, respawned, count, (uint64_t)stepCount, 0, blocks);
+
+            for (int j = 0; j < count; j++) {
+                int i = respawned[j];
+                args.x[i] = (float)RandomRange(blocks[j].word[0], 0, (int)config.width - 1);
+                args.y[i] = kRainRespawnY;
+            }
+        }
+        break;
+    }
+
+    case Scenario::Game: {
+        KernelPlayer kernelPlayer = {player.x, player.y, player.width, player.height, player.speed, player.input};
+        kernels->game(args, kernelPlayer, begin, end);
+        break;
+    }
+    }
+
+    // The level tree is read-only during the step, every range resolves its own particles against it
+    level.CollideRange(particles, begin, end, config.restitution);
+
+    if (pool.HasMortal()) {
+        AgeRange(begin, end, dt);
+    }
+}
@@ -0,0 +1,223 @@
+// Headless physics world shared by the raylib examples and the headless driver
+#pragma once
+
+#include <vector>
+
+#include "collision.h"
+#include "emitter.h"
+#include "kernels.h"
+#include "particle_pool.h"
+#include "particles.h"
+#include "platform.h"
+#include "random.h"
+#include "scheduler.h"
+#include "snapshot.h"
+#include "state_hash.h"
+#include "static_bvh.h"
+#include "xpbd.h"
+
+// Which example the world simulates
+enum class Scenario {
+    Bounce, // Particle Example: particles bouncing off the window edges
+    Rain,   // Rain Example: drops falling and respawning at the top
+    Game    // Main Game: gravity, drag and a player the particles bounce off
+};
+
+// How the game scenario moves particles and resolves contacts
+enum class SolverType {
+    Impulse, // Main Game's per-frame kernel with velocity flips, then one Jacobi impulse pass
+    Xpbd     // position-based substeps, see XpbdSolver
+};
+
+// Bounds and counts for a world, defaults match the Particle Example
+struct WorldConfig {
+    Scenario scenario = Scenario::Bounce;
+    float width = 800.0f;
+    float height = 600.0f;
+    int particleCount = 10000;
+    int capacity = 0;         // particles the pool has room for, 0 uses particleCount
+    float radiusScale = 1.0f; // multiplies the spawned radii, so larger counts fit in the same space
+    unsigned int seed = 1;
+    int grainSize = DEFAULT_GRAIN_SIZE; // particles per scheduler task
+    KernelIsa simd = KernelIsa::Auto;
+    bool collisions = false;  // particle-particle collisions
+    float restitution = 0.9f; // bounciness of particle-particle collisions
+    int sleepSteps = 0;       // steps below sleepSpeed before a particle sleeps, 0 never sleeps, at most 65535
+    float sleepSpeed = 1.0f;  // in the scenario's velocity units
+    SolverType solver = SolverType::Impulse; // only the game scenario supports Xpbd
+    int substeps = 4;         // Xpbd substeps per step
+    float compliance = 0.0f;  // Xpbd contact compliance, 0 keeps contacts rigid
+    std::vector<Emitter> emitters; // in place again after every Reset
+    std::vector<Aabb> platforms;   // static level geometry the particles bounce off, built into a tree on Reset
+};
+
+// Player rectangle from Main Game, input is -1 (left), 0 or 1 (right)
+struct PlayerState {
+    float x = 0.0f;
+    float y = 0.0f;
+    float width = 50.0f;
+    float height = 50.0f;
+    float speed = 5.0f;
+    int input = 0;
+};
+
+// Milliseconds spent in each phase, summed over every step since the world was created or ResetTimings
+struct PhaseTimings {
+    long long steps = 0;
+    double updateMs = 0.0;
+    double broadPhaseMs = 0.0;
+    double narrowPhaseMs = 0.0;
+    double snapshotMs = 0.0;
+};
+
+// Time spent between two totals, such as the ones carried by two snapshots
+PhaseTimings operator-(const PhaseTimings& a, const PhaseTimings& b);
+
+// What the renderer needs from one finished step, filled by the physics thread and read by the render thread
+struct RenderSnapshot {
+    AlignedArray<float> x;
+    AlignedArray<float> y;
+    AlignedArray<float> radius;
+    AlignedArray<Rgba> color;
+    PlayerState player;
+    long long step = 0;
+    long long layout = -1; // ParticleStore::layout when the snapshot was taken
+
+    int Size() const { return (int)x.Size(); }
+};
+
+// Config with the bounds and counts the original example used
+WorldConfig DefaultConfig(Scenario scenario);
+
+// Main Game Multi's game: particles at a quarter of their radius piling up on two staggered rows of ledges, with
+// four position-based substeps per step. About 25000 of them fill the 1280x800 world.
+WorldConfig PileGameConfig(int particleCount);
+
+// Parse "bounce", "rain" or "game", returns false on an unknown name
+bool ParseScenario(const char* name, Scenario& scenario);
+const char* ScenarioName(Scenario scenario);
+
+class World {
+public:
+    explicit World(const WorldConfig& config);
+
+    // Spawns on the scheduler's workers from the start, so the particle arrays are first written by the workers
+    // that update them (see Reset)
+    World(const WorldConfig& config, TaskScheduler& scheduler);
+
+    // Respawn every particle and the player from the config seed, the scheduler spawns ranges in parallel.
+    // Both give the same particles. The scheduler version first has every worker write its even share of the
+    // store, the share ParallelFor starts it on, so fresh pages land on the NUMA node of a pinned worker.
+    void Reset();
+    void Reset(TaskScheduler& scheduler);
+
+    // Add a particle between steps, returns an invalid handle once the pool is at capacity. It starts awake.
+    ParticleHandle Spawn(const Particle& p);
+
+    // Remove a particle between steps, returns false if it was already gone
+    bool Despawn(ParticleHandle handle);
+
+    // Add an emitter, returns its id. Emitters release particles at the end of every step, after the particles
+    // whose life ran out have been removed. Reset goes back to the emitters in the config.
+    int AddEmitter(const Emitter& emitter);
+    Emitter& GetEmitter(int id) { return emitters[id]; }
+    int EmitterCount() const { return (int)emitters.size(); }
+
+    // Advance the whole world by dt seconds. Spawns and despawns queued on the pool during the step are applied
+    // at its end.
+    void Step(float dt);
+
+    // Same as Step but the particle update runs as work-stealing range tasks on the scheduler
+    void Step(float dt, TaskScheduler& scheduler);
+
+    // The phases of one step, so a FrameGraph can run them as separate nodes. Step runs exactly these in this
+    // order. Each returns once its work is done, and nothing else may touch the world while one runs. The
+    // position-based solver interleaves all three middle phases every substep, so its Integrate does them all.
+    void BeginStep(TaskScheduler& scheduler) { BeginStep(&scheduler); }
+    void Integrate(float dt, TaskScheduler& scheduler) { Integrate(dt, &scheduler); }
+    void BroadPhase(TaskScheduler& scheduler) { BroadPhase(&scheduler); }
+    void NarrowPhase(TaskScheduler& scheduler) { NarrowPhase(&scheduler); }
+    void EndStep(float dt, TaskScheduler& scheduler) { EndStep(dt, &scheduler); }
+
+    // Copy the render state of the last step into a snapshot, the copy is split across the scheduler's workers
+    // when one is passed. Meant for the back slot of a TripleBuffer<RenderSnapshot>.
+    void WriteSnapshot(RenderSnapshot& snapshot) const;
+    void WriteSnapshot(RenderSnapshot& snapshot, TaskScheduler& scheduler) const;
+
+    // Hash of every particle, the player and the step count. The same state gives the same value whether it
+    // was hashed serially or on the scheduler, so runs with different thread counts can be compared.
+    uint64_t StateHash();
+    uint64_t StateHash(TaskScheduler& scheduler);
+
+    const WorldConfig& Config() const { return config; }
+    const KernelSet& Kernels() const { return *kernels; }
+    void SetCollisions(bool enabled) { config.collisions = enabled; }
+    ParticlePool& Pool() { return pool; }
+    const ParticlePool& Pool() const { return pool; }
+    ParticleStore& Particles() { return particles; }
+    const ParticleStore& Particles() const { return particles; }
+    int ParticleCount() const { return particles.Size(); }
+    long long StepCount() const { return stepCount; }
+    const PhaseTimings& Timings() const { return timings; }
+    void ResetTimings() { timings = PhaseTimings(); }
+    int ContactCount() const;
+    const StaticBvh& Level() const { return level; }
+
+    // Particles that stayed below the sleep speed for the configured number of steps sleep: they keep their
+    // place in the store behind every awake particle, skip the update and never look for contacts. An awake
+    // particle moving faster than the sleep speed that touches one wakes it, and so does the player moving into
+    // it. Sleeping particles still age and die.
+    int AwakeCount() const { return config.sleepSteps > 0 ? awake : particles.Size(); }
+    int SleepingCount() const { return particles.Size() - AwakeCount(); }
+
+    PlayerState player;
+
+private:
+    void ResetState();
+    void SpawnRange(int begin, int end);
+    void FirstTouch(TaskScheduler& scheduler);
+    bool UpdatePlayer();
+    void UpdateRange(int begin, int end, float dt);
+    void BeginStep(TaskScheduler* scheduler);
+    void Integrate(float dt, TaskScheduler* scheduler);
+    void BroadPhase(TaskScheduler* scheduler);
+    void NarrowPhase(TaskScheduler* scheduler);
+    void EndStep(float dt, TaskScheduler* scheduler);
+    bool UsesXpbd() const { return config.solver == SolverType::Xpbd && config.scenario == Scenario::Game; }
+    void StepXpbd(float dt, float playerStartX, TaskScheduler* scheduler);
+    void Sleep(bool playerMoved, TaskScheduler* scheduler);
+    int SettleRange(int begin, int end);
+    int WakeNearPlayer(int begin, int end);
+    void PartitionAwake();
+    void Lifecycle(float dt, TaskScheduler* scheduler);
+    void Emit(float dt, TaskScheduler* scheduler);
+    void AgeRange(int begin, int end, float dt);
+    void CopySnapshotRange(RenderSnapshot& snapshot, int begin, int end) const;
+    uint64_t HashRest(uint64_t particleHash) const;
+
+    WorldConfig config;
+    const KernelSet* kernels;
+    ParticleStore particles;
+    ParticlePool pool;
+    std::vector<Emitter> emitters;
+    CounterRandom random; // keyed by the seed, draws are addressed by particle index and step
+    SpatialGrid grid;
+    ContactSolver solver;
+    XpbdSolver xpbd;
+    StaticBvh level;
+    StateHasher hasher;
+    long long stepCount = 0;
+
+    // Set by BeginStep for the rest of the step
+    float stepPlayerStartX = 0.0f;
+    bool stepPlayerMoved = false;
+
+    // Awake particles are at [0, awake), sleeping ones after them. The partition is redone when particles
+    // fall asleep or wake, or when the store changed since the last partition.
+    int awake = 0;
+    bool sleepChanged = false;
+    long long partitionLayout = 0;
+    int partitionSize = 0;
+
+    mutable PhaseTimings timings; // WriteSnapshot is const but still records its time
+};
@@ -0,0 +1,233 @@
+#include "xpbd.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "scheduler.h"
+#include "trace.h"
+
+// Ranges of grid slots per scheduler task, same as the impulse solver
+static const int kGatherGrain = 512;
+
+// Over-relaxation of the correction averaged over the touching neighbours. Plain averaging moves a particle in a
+// deep pile too little to hold up the weight above it, 1.5 leaves a quarter fewer overlapping pairs in a settled
+// pile.
+static const float kRelaxation = 1.5f;
+
+void XpbdSolver::Begin(int count, int workerCount) {
+    previousX.Resize(count);
+    previousY.Resize(count);
+    dx.Resize(count);
+    dy.Resize(count);
+
+    if ((int)workers.size() < workerCount) workers.resize(workerCount);
+    for (WorkerState& worker : workers) {
+        worker.contacts = 0;
+        worker.woken.Clear();
+    }
+    contactCount = 0;
+}
+
+void XpbdSolver::PredictRange(ParticleStore& particles, const XpbdParams& params, int begin, int end) {
+    TRACE_ZONE("Xpbd Predict");
+    float* x = particles.x.Data();
+    float* y = particles.y.Data();
+    float* vx = particles.vx.Data();
+    float* vy = particles.vy.Data();
+    const float h = params.h;
+
+    for (int i = begin; i < end; i++) {
+        previousX[i] = x[i];
+        previousY[i] = y[i];
+
+        vy[i] += params.gravity * h;
+        vx[i] *= params.drag;
+        vx[i] = std::min(std::max(vx[i], -params.maxSpeed), params.maxSpeed);
+        vy[i] = std::min(std::max(vy[i], -params.maxSpeed), params.maxSpeed);
+
+        x[i] += vx[i] * h;
+        y[i] += vy[i] * h;
+    }
+}
+
+// Non-penetration of every overlapping pair, C = distance - (ra + rb). Mass goes with radius squared and a
+// sleeping neighbour does not move, so it counts as infinitely heavy. Reads only the store and the previous
+// positions, writes only the corrections of the particles it owns and its own wake list.
+int XpbdSolver::GatherRange(const ParticleStore& particles, const SpatialGrid& grid, const XpbdParams& params,
+                            int beginSlot, int endSlot, AlignedArray<int>& woken) {
+    TRACE_ZONE("Xpbd Contacts");
+    const float* x = particles.x.Data();
+    const float* y = particles.y.Data();
+    const float* radius = particles.radius.Data();
+    const float complianceTerm = params.compliance / (params.h * params.h);
+    const float wakeDistance = params.wakeSpeed * params.h;
+    int pairs = 0;
+
+    for (int slot = beginSlot; slot < endSlot; slot++) {
+        const int a = grid.ParticleAt(slot);
+        if (a >= params.awake) continue;
+
+        const float ax = x[a];
+        const float ay = y[a];
+        const float aRadius = radius[a];
+        const float invMassA = aRadius > 0.0f ? 1.0f / (aRadius * aRadius) : 0.0f;
+        const float moveAx = ax - previousX[a];
+        const float moveAy = ay - previousY[a];
+        const bool wakes = moveAx * moveAx + moveAy * moveAy > wakeDistance * wakeDistance;
+
+        float sumX = 0.0f;
+        float sumY = 0.0f;
+        int touching = 0;
+
+        grid.ForEachNear(ax, ay, [&](int b) {
+            if (b == a) return;
+
+            float dxAB = x[b] - ax;
+            float dyAB = y[b] - ay;
+            float distanceSquared = dxAB * dxAB + dyAB * dyAB;
+            float reach = aRadius + radius[b];
+            if (distanceSquared >= reach * reach) return;
+
+            touching++;
+            if (b > a) pairs++;
+
+            const bool asleep = b >= params.awake;
+            if (asleep && wakes) woken.PushBack(b);
+
+            float invMassB = (!asleep && radius[b] > 0.0f) ? 1.0f / (radius[b] * radius[b]) : 0.0f;
+            float invMassSum = invMassA + invMassB;
+            if (invMassSum <= 0.0f) return;
+
+            // Coincident centers get a fixed normal so both sides of the pair agree on it
+            float distance = std::sqrt(distanceSquared);
+            float nx = a < b ? 1.0f : -1.0f;
+            float ny = 0.0f;
+            if (distance > 0.0f) {
+                nx = dxAB / distance;
+                ny = dyAB / distance;
+            }
+
+            // One XPBD iteration from a zero multiplier, our share goes against the normal
+            float lambda = (reach - distance) / (invMassSum + complianceTerm);
+            sumX -= nx * lambda * invMassA;
+            sumY -= ny * lambda * invMassA;
+
+            // Friction takes out part of the sliding between the two over this substep
+            float slipX = moveAx;
+            float slipY = moveAy;
+            if (!asleep) {
+                slipX -= x[b] - previousX[b];
+                slipY -= y[b] - previousY[b];
+            }
+            float normalSlip = slipX * nx + slipY * ny;
+            float share = params.friction * invMassA / invMassSum;
+            sumX -= (slipX - normalSlip * nx) * share;
+            sumY -= (slipY - normalSlip * ny) * share;
+        });
+
+        // Constraint averaging, several contacts pushing at once would otherwise overshoot
+        float share = touching > 1 ? kRelaxation / (float)touching : 1.0f;
+        dx[a] = sumX * share;
+        dy[a] = sumY * share;
+    }
+    return pairs;
+}
+
+// Apply the contact corrections, then the constraints that involve only one particle, then derive velocities
+void XpbdSolver::ApplyRange(ParticleStore& particles, const XpbdParams& params, bool contacts, int begin, int end) {
+    TRACE_ZONE("Xpbd Apply");
+    float* x = particles.x.Data();
+    float* y = particles.y.Data();
+    float* vx = particles.vx.Data();
+    float* vy = particles.vy.Data();
+    const float* radius = particles.radius.Data();
+    const Aabb player = {params.player.x, params.player.y, params.player.x + params.player.width,
+                         params.player.y + params.player.height};
+
+    // dx, dy are spent once added, they keep where each particle would be without contacts and walls
+    for (int i = begin; i < end; i++) {
+        const float r = radius[i];
+        float freeX = x[i];
+        float freeY = y[i];
+        if (contacts) {
+            x[i] += dx[i];
+            y[i] += dy[i];
+        }
+
+        // The player is kinematic: it moves whatever is in its way and nothing moves it. What it touches is
+        // carried along at its speed, only pushing it out of the player on top of that is capped below.
+        float nx = 0.0f;
+        float ny = 0.0f;
+        if (PushOutOfBox(player, r, x[i], y[i], nx, ny)) freeX += params.playerMove;
+
+        // Walls and floor, resting on the floor takes out part of the sliding
+        x[i] = std::min(std::max(x[i], r), params.width - r);
+        if (y[i] > params.height - r) {
+            y[i] = params.height - r;
+            x[i] -= (x[i] - previousX[i]) * params.friction;
+        }
+        y[i] = std::max(y[i], r);
+        dx[i] = freeX;
+        dy[i] = freeY;
+    }
+
+    if (params.level) params.level->CollideRange(particles, begin, end, 0.0f);
+
+    // Corrections stop a particle moving into what it touches, but the part of them that pushes it back out of an
+    // overlap would leave as velocity. Deep in a pile the floor, the walls and the neighbours keep pushing against
+    // each other, so that part is capped at depenetrationSpeed or the pile never calms down below the sleep speed.
+    const float inverseH = 1.0f / params.h;
+    const float maxSeparation = params.depenetrationSpeed * params.h;
+    for (int i = begin; i < end; i++) {
+        const float cx = x[i] - dx[i];
+        const float cy = y[i] - dy[i];
+        const float length = std::sqrt(cx * cx + cy * cy);
+        if (length > 0.0f) {
+            const float nx = cx / length;
+            const float ny = cy / length;
+            const float before = (dx[i] - previousX[i]) * nx + (dy[i] - previousY[i]) * ny;
+            const float excess = before + length - std::max(before, maxSeparation);
+            if (excess > 0.0f) {
+                previousX[i] += nx * excess;
+                previousY[i] += ny * excess;
+            }
+        }
+        vx[i] = (x[i] - previousX[i]) * inverseH;
+        vy[i] = (y[i] - previousY[i]) * inverseH;
+    }
+}
+
+void XpbdSolver::Predict(ParticleStore& particles, const XpbdParams& params) {
+    PredictRange(particles, params, 0, params.awake);
+}
+
+void XpbdSolver::Predict(ParticleStore& particles, const XpbdParams& params, TaskScheduler& scheduler) {
+    scheduler.ParallelFor(0, params.awake, DEFAULT_GRAIN_SIZE, [&](int begin, int end, int) {
+        PredictRange(particles, params, begin, end);
+    });
+}
+
+void XpbdSolver::Project(ParticleStore& particles, const SpatialGrid* grid, const XpbdParams& params) {
+    TRACE_ZONE("Narrow Phase");
+    if (grid) contactCount = GatherRange(particles, *grid, params, 0, particles.Size(), workers[0].woken);
+    ApplyRange(particles, params, grid != nullptr, 0, params.awake);
+}
+
+void XpbdSolver::Project(ParticleStore& particles, const SpatialGrid* grid, const XpbdParams& params,
+                         TaskScheduler& scheduler) {
+    TRACE_ZONE("Narrow Phase");
+    if (grid) {
+        for (WorkerState& worker : workers) worker.contacts = 0;
+        scheduler.ParallelFor(0, particles.Size(), kGatherGrain, [&](int begin, int end, int worker) {
+            WorkerState& state = workers[worker];
+            state.contacts += GatherRange(particles, *grid, params, begin, end, state.woken);
+        });
+        contactCount = 0;
+        for (const WorkerState& worker : workers) contactCount += worker.contacts;
+    }
+
+    // Nobody moves until every correction has been gathered
+    scheduler.ParallelFor(0, params.awake, DEFAULT_GRAIN_SIZE, [&](int begin, int end, int) {
+        ApplyRange(particles, params, grid != nullptr, begin, end);
+    });
+}
@@ -0,0 +1,210 @@
+#include <raylib.h>
+#include <chrono>
+
+#include "batch_renderer.h"
+#include "frame_graph.h"
+#include "metrics.h"
+#include "scheduler.h"
+#include "sim_clock.h"
+#include "trace.h"
+#include "world.h"
+
+void DrawPlayer(const PlayerState& player)
+{
+  DrawRectangle(player.x, player.y, player.width, player.height, WHITE);
+}
+
+void DrawPlatform(const Aabb& platform)
+{
+  DrawRectangle(platform.minX, platform.minY, platform.maxX - platform.minX, platform.maxY - platform.minY, GRAY);
+}
+
+//Everything the main thread draws for one frame. The frame graph fills one while the main thread draws the other.
+struct FrameOutput
+{
+  DrawBatch batch;
+  PlayerState player;
+  int particles = 0;
+  int asleep = 0;
+  float sim_ms = 0.0f;
+  PhaseTimings timings;
+  std::chrono::high_resolution_clock::time_point start;
+};
+
+//Snapshot of the arrow keys, read once per frame and handed to every worker through the world
+int ReadPlayerInput()
+{
+  if(IsKeyDown(KEY_LEFT))
+  {
+    return -1;
+  } else if(IsKeyDown(KEY_RIGHT))
+  {
+    return 1;
+  }
+  return 0;
+}
+
+//One frame as a graph: input, then the player and physics phases of every fixed step in a chain, then publish and
+//render prep side by side. Rebuilt every frame since the number of steps changes, it is only a few nodes.
+void BuildFrame(FrameGraph& graph, World& world, TaskScheduler& scheduler, RenderSnapshot& previous, FrameOutput& output,
+                int input, int steps, float dt, float alpha, float snap_distance)
+{
+  graph.Clear();
+  int last = graph.AddNode("Input", [&world, &output, input]
+  {
+    output.start = std::chrono::high_resolution_clock::now();
+    world.player.input = input;
+  });
+
+  for(int i = 0; i < steps; i++)
+  {
+    //Drawing blends from the state before the last step
+    bool keep_previous = i == steps - 1;
+    int player = graph.AddNode("Player", [&world, &scheduler, &previous, keep_previous]
+    {
+      if(keep_previous) world.WriteSnapshot(previous, scheduler);
+      world.BeginStep(scheduler);
+    });
+    int integrate = graph.AddNode("Integrate", [&world, &scheduler, dt] { world.Integrate(dt, scheduler); });
+    int broad_phase = graph.AddNode("Broad Phase", [&world, &scheduler] { world.BroadPhase(scheduler); });
+    int narrow_phase = graph.AddNode("Narrow Phase", [&world, &scheduler] { world.NarrowPhase(scheduler); });
+    int end_step = graph.AddNode("End Step", [&world, &scheduler, dt] { world.EndStep(dt, scheduler); });
+    graph.AddEdge(last, player);
+    graph.AddEdge(player, integrate);
+    graph.AddEdge(integrate, broad_phase);
+    graph.AddEdge(broad_phase, narrow_phase);
+    graph.AddEdge(narrow_phase, end_step);
+    last = end_step;
+  }
+
+  //Both only read the world, publish copies what the HUD and metrics need while the workers build the vertices
+  int publish = graph.AddNode("Publish", [&world, &output]
+  {
+    output.player = world.player;
+    output.particles = world.ParticleCount();
+    output.asleep = world.SleepingCount();
+    output.timings = world.Timings();
+    world.ResetTimings();
+  });
+  int render_prep = graph.AddNode("Render Prep", [&world, &scheduler, &previous, &output, alpha, snap_distance]
+  {
+    output.batch.BuildCircles(MakeDrawSource(previous, world.Particles(), alpha, snap_distance), scheduler);
+    output.sim_ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - output.start).count();
+  });
+  graph.AddEdge(last, publish);
+  graph.AddEdge(last, render_prep);
+}
+
+int main()
+{
+  const int screen_width = 1280;
+  const int screen_height = 800;
+
+  //Tens of thousands of particles piling up on ledges, the same setup Engine/physics_bench times for the game
+  WorldConfig config = PileGameConfig(20000);
+  config.width = screen_width;
+  config.height = screen_height;
+
+  //Persistent workers, one per physical core, parked between frames and balanced by work stealing.
+  //The first core is reserved for the main thread, which draws while the workers simulate the next frame.
+  PlacementConfig placement_config;
+  placement_config.policy = PlacementPolicy::PhysicalFirst;
+  placement_config.reservedCores = 1;
+  WorkerPlacement placement = PlaceWorkers(CpuTopology::Detect(), placement_config);
+  WorkerPool pool(placement);
+  TaskScheduler scheduler(pool);
+  const int num_threads = pool.ThreadCount();
+
+  //Every worker first touches the particles it steps, the main thread stands in for worker 0 on its core
+  PinCurrentThread(placement.cpus[0]);
+  World world(config, scheduler);
+  if(!placement.reserved.empty()) PinCurrentThread(placement.reserved[0]);
+
+  InitWindow(screen_width, screen_height, "2D Physics (Multi-threaded)");
+
+  //Uncapped like the other Multi examples, the fixed-step clock keeps the game at its tuned speed
+  SetTargetFPS(0);
+
+  //Every particle goes into one vertex buffer, built by the workers and drawn in a single call
+  BatchRenderer renderer;
+  renderer.Load();
+
+  //The game was tuned per frame at 60 FPS, so it steps at that rate whatever the frame rate is
+  FixedStepClock clock(GAME_TICK_RATE);
+  RenderSnapshot previous;
+
+  //The frame graph simulates the next frame while the main thread draws this one, so drawing is a frame behind.
+  //Its lanes run the pool as worker 0, so they go on worker 0's core.
+  FrameGraph graph(2, placement.cpus[0]);
+  FrameOutput outputs[2];
+  int back = 0;
+
+  //Frame metrics are queued to a background writer, Engine/physics_metrics_csv turns the file into CSV.
+  //Only the first 30 seconds are logged, the game keeps running after that.
+  MetricsLogger metrics;
+  metrics.Open("game_frametime_multi.metrics");
+  auto start_logging_time = std::chrono::high_resolution_clock::now();
+  const float logging_duration = 30.0f;
+
+  TRACE_THREAD_NAME("Main");
+
+  //Game Loop
+  while(WindowShouldClose() == false)
+  {
+    TRACE_ZONE("Frame");
+
+    //The frame the graph just finished is drawn below, the other output is free for the next one
+    graph.Wait();
+    const FrameOutput& frame = outputs[back];
+    back = 1 - back;
+
+    //Input is read here and handed to the graph, raylib is only called from the main thread
+    int steps = clock.Advance(GetFrameTime());
+    BuildFrame(graph, world, scheduler, previous, outputs[back], ReadPlayerInput(), steps, clock.StepSeconds(), clock.Alpha(), screen_height / 2.0f);
+    graph.Launch();
+
+    float elapsed_time = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start_logging_time).count();
+
+    //Drawing, only from the finished frame while the graph runs the next one
+    auto draw_start_time = std::chrono::high_resolution_clock::now();
+    BeginDrawing();
+    ClearBackground(BLACK);
+    DrawPlayer(frame.player);
+    for(const Aabb& platform : world.Config().platforms)
+    {
+      DrawPlatform(platform);
+    }
+
+    renderer.Draw(frame.batch);
+
+    DrawText(TextFormat("Particles: %d (%d asleep)", frame.particles, frame.asleep), 10, 10, 20, WHITE);
+    DrawText(TextFormat("Threads: %d", num_threads), 10, 40, 20, WHITE);
+    DrawText(TextFormat("Frame Time: %.2f ms", frame.sim_ms), 10, 70, 20, WHITE);
+
+    EndDrawing();
+
+    //Log the frame, the file is written on the logger's own thread
+    if(elapsed_time < logging_duration)
+    {
+      MetricsSample sample;
+      sample.time = elapsed_time;
+      sample.frameMs = GetFrameTime() * 1000.0f;
+      sample.fps = GetFPS();
+      sample.drawMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - draw_start_time).count();
+      sample.particles = frame.particles;
+      sample.threads = num_threads;
+      AddPhaseTimings(sample, frame.timings);
+      metrics.Log(sample);
+    }
+  }
+
+  graph.Wait();
+  metrics.Close();
+
+  //Per-worker timeline of the last frames, open in Perfetto. Only written by a TRACE=1 build.
+  if(TraceEnabled()) WriteChromeTrace("game_trace_multi.json");
+
+  renderer.Unload();
+  CloseWindow();
+  return 0;
+}
@@ -1,158 +1,136 @@
 #include <raylib.h>
 #include <vector>
 #include <cmath>
-#include <thread>
-#include <mutex>
-#include <atomic>
-
-// Single particle position, velocity, radius and color
-struct Particle {
-    Vector2 position;
-    Vector2 velocity;
-    float radius;
-    Color color;
-};
+#include <chrono>
+
+#include "batch_renderer.h"
+#include "scheduler.h"
+#include "sim_clock.h"
+#include "trace.h"
+#include "world.h"
 
 const int screenWidth = 800;
 const int screenHeight = 600;
-const int particleCount = 10000;
-
-std::vector<Particle> particles;
-
-// Mutex for logging
-std::mutex logMutex;
-
-// Stop flag for threads
-std::atomic<bool> stopThreads(false);
 
-std::atomic<float> deltaTime(0.016f);
-std::vector<std::thread> threads;
-int numThreads;
-bool isMultithreaded = false;
+int main() {
+    InitWindow(screenWidth, screenHeight, "Toggle Single/Multi-threaded Simulation");
 
-// Initialize particles
-void InitParticles() {
-    particles.clear();
-    particles.reserve(particleCount);
+    // Initialize particles
+    WorldConfig config = DefaultConfig(Scenario::Bounce);
+    config.width = screenWidth;
+    config.height = screenHeight;
+    config.capacity = config.particleCount + 50000;
+
+    // Clicking sets off a burst of sparks that fade out within two seconds
+    Emitter sparks;
+    sparks.speedMin = 50.0f;
+    sparks.speedMax = 300.0f;
+    sparks.lifetime = 0.5f;
+    sparks.lifetimeJitter = 1.5f;
+    config.emitters.push_back(sparks);
+    World world(config);
+
+    // Workers stay parked while running single-threaded
+    WorkerPool pool;
+    TaskScheduler scheduler(pool);
+    bool isMultithreaded = false;
+    bool collisions = false;
+
+    // Batched drawing puts every particle in one vertex buffer and one draw call
+    BatchRenderer renderer;
+    renderer.Load();
+    DrawBatch batch;
+    bool batched = true;
+
+    // Physics runs at a fixed rate whatever the frame rate, drawing blends the last two steps
+    FixedStepClock clock;
+    RenderSnapshot previous;
+    const float snapDistance = screenHeight / 2.0f;
 
-    for (int i = 0; i < particleCount; i++) {
-        particles.push_back({
-            {(float)GetRandomValue(0, screenWidth), (float)GetRandomValue(0, screenHeight)},
-            {(float)GetRandomValue(-200, 200) / 100.0f, (float)GetRandomValue(-200, 200) / 100.0f},
-            (float)GetRandomValue(2, 5),
-            {(unsigned char)GetRandomValue(50, 255), (unsigned char)GetRandomValue(50, 255), (unsigned char)GetRandomValue(50, 255), 255}
-        });
-    }
-}
+    SetTargetFPS(0);
 
-// Update particles position single-threaded
-void UpdateParticlesSingle(float delta) {
-    for (auto& p : particles) {
-        p.position.x += p.velocity.x * delta;
-        p.position.y += p.velocity.y * delta;
+    TRACE_THREAD_NAME("Main");
+    while (!WindowShouldClose()) {
+        TRACE_ZONE("Frame");
 
-        if (p.position.x <= p.radius || p.position.x >= screenWidth - p.radius) {
-            p.velocity.x *= -1;
-        }
-        if (p.position.y <= p.radius || p.position.y >= screenHeight - p.radius) {
-            p.velocity.y *= -1;
+        // Toggle single and mulit-threading with space
+        if (IsKeyPressed(KEY_SPACE)) {
+            isMultithreaded = !isMultithreaded;
         }
-    }
-}
-
-// Update subset of particles
-void UpdateParticlesChunk(int start, int end, float delta) {
-    for (int i = start; i < end; i++) {
-        Particle& p = particles[i];
-
-        p.position.x += p.velocity.x * delta;
-        p.position.y += p.velocity.y * delta;
 
-        if (p.position.x <= p.radius || p.position.x >= screenWidth - p.radius) {
-            p.velocity.x *= -1;
+        // Toggle particle-particle collisions with C
+        if (IsKeyPressed(KEY_C)) {
+            collisions = !collisions;
+            world.SetCollisions(collisions);
         }
-        if (p.position.y <= p.radius || p.position.y >= screenHeight - p.radius) {
-            p.velocity.y *= -1;
-        }
-    }
-}
-
-// Worker thread function
-void WorkerThread(int start, int end) {
-    while (!stopThreads) {
-        UpdateParticlesChunk(start, end, deltaTime.load());
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
-    }
-}
-
-// Start and stopping of threads to handle simulation
-void StartThreads() {
-    numThreads = std::thread::hardware_concurrency();
-    if (numThreads == 0) numThreads = 4;
-
-    int chunkSize = particleCount / numThreads;
-    threads.clear();
-
-    for (int t = 0; t < numThreads; t++) {
-        int start = t * chunkSize;
-        int end = (t == numThreads - 1) ? particleCount : start + chunkSize;
-        threads.emplace_back(WorkerThread, start, end);
-    }
-}
 
-void StopThreads() {
-    stopThreads = true;
-    for (auto& thread : threads) {
-        if (thread.joinable()) thread.join();
-    }
-    stopThreads = false;
-}
-
-int main() {
-    InitWindow(screenWidth, screenHeight, "Toggle Single/Multi-threaded Simulation");
-    InitParticles();
-    SetTargetFPS(0);
+        // Toggle batched and per-particle drawing with B
+        if (IsKeyPressed(KEY_B)) {
+            batched = !batched;
+        }
 
-    while (!WindowShouldClose()) {
-        // Toggle single and mulit-threading with space
-        if (IsKeyPressed(KEY_SPACE)) {
-            isMultithreaded = !isMultithreaded;
+        // Burst of sparks at the mouse with a left click
+        if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
+            Vector2 mouse = GetMousePosition();
+            world.GetEmitter(0).position = {mouse.x, mouse.y};
+            world.GetEmitter(0).burst += 2000;
+        }
 
+        auto frameStartTime = std::chrono::high_resolution_clock::now();
+        int steps = clock.Advance(GetFrameTime());
+        for (int i = 0; i < steps; i++) {
             if (isMultithreaded) {
-                StartThreads();
+                if (i == steps - 1) world.WriteSnapshot(previous, scheduler);
+                world.Step(clock.StepSeconds(), scheduler);
             } else {
-                StopThreads();
+                if (i == steps - 1) world.WriteSnapshot(previous);
+                world.Step(clock.StepSeconds());
             }
         }
 
-        auto frameStartTime = std::chrono::high_resolution_clock::now();
-        float dt = GetFrameTime();
-        deltaTime.store(dt);
-
-        if (!isMultithreaded) {
-            UpdateParticlesSingle(dt);
-        }
-
         auto frameEndTime = std::chrono::high_resolution_clock::now();
         float frameTime = std::chrono::duration<float, std::milli>(frameEndTime - frameStartTime).count();
 
+        DrawSource source = MakeDrawSource(previous, world.Particles(), clock.Alpha(), snapDistance);
+        if (batched) {
+            if (isMultithreaded) {
+                batch.BuildCircles(source, scheduler);
+            } else {
+                batch.BuildCircles(source);
+            }
+        }
+
         BeginDrawing();
         ClearBackground(BLACK);
 
-        for (const auto& p : particles) {
-            DrawCircleV(p.position, p.radius, p.color);
+        if (batched) {
+            renderer.Draw(batch);
+        } else {
+            for (int i = 0; i < source.count; i++) {
+                Vec2 p = DrawPosition(source, i);
+                DrawCircleV({p.x, p.y}, source.radius[i], {source.color[i].r, source.color[i].g, source.color[i].b, source.color[i].a});
+            }
         }
 
         DrawText(TextFormat("Mode: %s", isMultithreaded ? "Multi-threaded" : "Single-threaded"), 10, 10, 20, WHITE);
-        DrawText(TextFormat("Particles: %d", particleCount), 10, 40, 20, WHITE);
-        DrawText(TextFormat("Frame Time: %.2f ms", frameTime), 10, 70, 20, WHITE);
-        DrawText("Press SPACE to toggle threading mode", 10, 100, 20, YELLOW);
+        DrawText(TextFormat("Particles: %d", world.ParticleCount()), 10, 40, 20, WHITE);
+        if (isMultithreaded) {
+            DrawText(TextFormat("Frame Time: %.2f ms (%d threads)", frameTime, pool.ThreadCount()), 10, 70, 20, WHITE);
+        } else {
+            DrawText(TextFormat("Frame Time: %.2f ms", frameTime), 10, 70, 20, WHITE);
+        }
+        DrawText(TextFormat("Collisions: %s (%d contacts)", collisions ? "On" : "Off", world.ContactCount()), 10, 100, 20, WHITE);
+        DrawText(TextFormat("Drawing: %s", batched ? "Batched" : "Per particle"), 10, 130, 20, WHITE);
+        DrawText("Press SPACE to toggle threading mode, C to toggle collisions, B to toggle batching", 10, 160, 20, YELLOW);
+        DrawText("Click to set off sparks", 10, 190, 20, YELLOW);
 
         EndDrawing();
     }
 
-    if (isMultithreaded) StopThreads();
+    // Only written by a TRACE=1 build
+    if (TraceEnabled()) WriteChromeTrace("particle_trace_combined.json");
 
+    renderer.Unload();
     CloseWindow();
     return 0;
-}
\ No newline at end of file
+}
@@ -2,51 +2,61 @@
 #include <raylib.h>
 #include <vector>
 #include <cmath>
-#include <fstream>
 #include <chrono>
-#include <thread>
-#include <mutex>
-#include <atomic>
-
-// Single particle position, velocity, radius and color
-struct Particle {
-    Vector2 position;
-    Vector2 velocity;
-    float radius;
-    Color color;
-};
-
-// Mutex for logging
-std::mutex logMutex;
-
-// Stop flag for threads
-std::atomic<bool> stopThreads(false);
 
-// Update subset of particles
-void UpdateParticles(std::vector<Particle>& particles, int start, int end, float screenWidth, float screenHeight, float deltaTime) {
-    for (int i = start; i < end; i++) {
-        Particle& p = particles[i];
-
-        // Update position
-        p.position.x += p.velocity.x * deltaTime;
-        p.position.y += p.velocity.y * deltaTime;
+#include "batch_renderer.h"
+#include "frame_graph.h"
+#include "metrics.h"
+#include "scheduler.h"
+#include "sim_clock.h"
+#include "trace.h"
+#include "world.h"
+
+// Everything the main thread draws for one frame. The frame graph fills one while the main thread draws the other.
+struct FrameOutput {
+    DrawBatch batch;
+    float simMs = 0.0f;
+    PhaseTimings timings;
+    std::chrono::high_resolution_clock::time_point start;
+};
 
-        // Bounce off walls
-        if (p.position.x <= p.radius || p.position.x >= screenWidth - p.radius) {
-            p.velocity.x *= -1;
-        }
-        if (p.position.y <= p.radius || p.position.y >= screenHeight - p.radius) {
-            p.velocity.y *= -1;
-        }
+// One frame as a graph: the physics phases of every fixed step in a chain, then publish and render prep side by
+// side. Rebuilt every frame since the number of steps changes, it is only a few nodes.
+void BuildFrame(FrameGraph& graph, World& world, TaskScheduler& scheduler, RenderSnapshot& previous, FrameOutput& output,
+                int steps, float dt, float alpha, float snapDistance) {
+    graph.Clear();
+    int last = graph.AddNode("Start", [&output] { output.start = std::chrono::high_resolution_clock::now(); });
+
+    for (int i = 0; i < steps; i++) {
+        // Drawing blends from the state before the last step
+        bool keepPrevious = i == steps - 1;
+        int begin = graph.AddNode("Begin Step", [&world, &scheduler, &previous, keepPrevious] {
+            if (keepPrevious) world.WriteSnapshot(previous, scheduler);
+            world.BeginStep(scheduler);
+        });
+        int integrate = graph.AddNode("Integrate", [&world, &scheduler, dt] { world.Integrate(dt, scheduler); });
+        int broadPhase = graph.AddNode("Broad Phase", [&world, &scheduler] { world.BroadPhase(scheduler); });
+        int narrowPhase = graph.AddNode("Narrow Phase", [&world, &scheduler] { world.NarrowPhase(scheduler); });
+        int endStep = graph.AddNode("End Step", [&world, &scheduler, dt] { world.EndStep(dt, scheduler); });
+        graph.AddEdge(last, begin);
+        graph.AddEdge(begin, integrate);
+        graph.AddEdge(integrate, broadPhase);
+        graph.AddEdge(broadPhase, narrowPhase);
+        graph.AddEdge(narrowPhase, endStep);
+        last = endStep;
     }
-}
 
-// Worker thread function
-void WorkerThread(std::vector<Particle>& particles, int start, int end, float screenWidth, float screenHeight, std::atomic<float>& deltaTime) {
-    while (!stopThreads) {
-        UpdateParticles(particles, start, end, screenWidth, screenHeight, deltaTime.load());
-        std::this_thread::sleep_for(std::chrono::milliseconds(1)); // Prevent CPU overuse
-    }
+    // Both only read the particles, publish takes the timings while the workers build the vertices
+    int publish = graph.AddNode("Publish", [&world, &output] {
+        output.timings = world.Timings();
+        world.ResetTimings();
+    });
+    int renderPrep = graph.AddNode("Render Prep", [&world, &scheduler, &previous, &output, alpha, snapDistance] {
+        output.batch.BuildCircles(MakeDrawSource(previous, world.Particles(), alpha, snapDistance), scheduler);
+        output.simMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - output.start).count();
+    });
+    graph.AddEdge(last, publish);
+    graph.AddEdge(last, renderPrep);
 }
 
 int main() {
@@ -55,96 +65,93 @@ int main() {
     InitWindow(screenWidth, screenHeight, "Multi-threaded Physics Simulation");
 
     // Create particles
-    const int particleCount = 10000;
-    std::vector<Particle> particles;
-    particles.reserve(particleCount);
-
-    for (int i = 0; i < particleCount; i++) {
-        particles.push_back({
-            {(float)GetRandomValue(0, screenWidth), (float)GetRandomValue(0, screenHeight)},
-            {(float)GetRandomValue(-200, 200) / 100.0f, (float)GetRandomValue(-200, 200) / 100.0f},
-            (float)GetRandomValue(2, 5),
-            {(unsigned char)GetRandomValue(50, 255), (unsigned char)GetRandomValue(50, 255), (unsigned char)GetRandomValue(50, 255), 255}
-        });
-    }
+    WorldConfig config = DefaultConfig(Scenario::Bounce);
+    config.width = screenWidth;
+    config.height = screenHeight;
+    World world(config);
+    const int particleCount = world.ParticleCount();
 
     SetTargetFPS(0);
 
-    // Get number of threads available
-    int numThreads = std::thread::hardware_concurrency();
-    if (numThreads == 0) numThreads = 4; // Default = 4
+    // Persistent workers, one per core, parked between frames and balanced by work stealing
+    WorkerPool pool;
+    TaskScheduler scheduler(pool);
+    const int numThreads = pool.ThreadCount();
 
-    std::vector<std::thread> threads;
-    std::atomic<float> deltaTime(0.016f);
+    // Every particle goes into one vertex buffer, built by the workers and drawn in a single call
+    BatchRenderer renderer;
+    renderer.Load();
 
-    int chunkSize = particleCount / numThreads;
+    // Physics runs at a fixed rate whatever the frame rate, drawing blends the last two steps
+    FixedStepClock clock;
+    RenderSnapshot previous;
+    const float snapDistance = screenHeight / 2.0f;
 
-    // Start worker threads
-    for (int t = 0; t < numThreads; t++) {
-        int start = t * chunkSize;
-        int end = (t == numThreads - 1) ? particleCount : start + chunkSize;
-        threads.emplace_back(WorkerThread, std::ref(particles), start, end, screenWidth, screenHeight, std::ref(deltaTime));
-    }
+    // The frame graph simulates the next frame while the main thread draws this one, so drawing is a frame behind
+    FrameGraph graph;
+    FrameOutput outputs[2];
+    int back = 0;
 
-    // Frame time logging
-    std::vector<std::pair<float, float>> frameTimeLog;
+    // Frame metrics are queued to a background writer, Engine/physics_metrics_csv turns the file into CSV
+    MetricsLogger metrics;
+    metrics.Open("particle_frametime_multi.metrics");
     auto startLoggingTime = std::chrono::high_resolution_clock::now();
     const float loggingDuration = 30.0f;
 
+    TRACE_THREAD_NAME("Main");
     while (!WindowShouldClose()) {
-        // Measure fame time
-        auto frameStartTime = std::chrono::high_resolution_clock::now();
-        deltaTime.store(GetFrameTime());
+        TRACE_ZONE("Frame");
+
+        // The frame the graph just finished is drawn below, the other output is free for the next one
+        graph.Wait();
+        const FrameOutput& frame = outputs[back];
+        back = 1 - back;
 
-        // Measure update time
-        auto frameEndTime = std::chrono::high_resolution_clock::now();
-        float frameTime = std::chrono::duration<float, std::milli>(frameEndTime - frameStartTime).count();
+        // Start the next frame's physics on the workers, it runs while this frame is drawn
+        int steps = clock.Advance(GetFrameTime());
+        BuildFrame(graph, world, scheduler, previous, outputs[back], steps, clock.StepSeconds(), clock.Alpha(), snapDistance);
+        graph.Launch();
 
-        // Log frame time
         auto currentTime = std::chrono::high_resolution_clock::now();
         float elapsedTime = std::chrono::duration<float>(currentTime - startLoggingTime).count();
 
-        {
-            std::lock_guard<std::mutex> lock(logMutex);
-            frameTimeLog.push_back({elapsedTime, frameTime});
-        }
-
         // Draw particles
+        auto drawStartTime = std::chrono::high_resolution_clock::now();
         BeginDrawing();
         ClearBackground(BLACK);
 
-        for (const auto& p : particles) {
-            DrawCircleV(p.position, p.radius, p.color);
-        }
+        renderer.Draw(frame.batch);
 
         DrawText(TextFormat("Particles: %d", particleCount), 10, 10, 20, WHITE);
         DrawText(TextFormat("Threads: %d", numThreads), 10, 40, 20, WHITE);
-        DrawText(TextFormat("Frame Time: %.2f ms", frameTime), 10, 70, 20, WHITE);
+        DrawText(TextFormat("Frame Time: %.2f ms", frame.simMs), 10, 70, 20, WHITE);
 
         EndDrawing();
 
+        // Log the frame, the file is written on the logger's own thread
+        MetricsSample sample;
+        sample.time = elapsedTime;
+        sample.frameMs = GetFrameTime() * 1000.0f;
+        sample.fps = GetFPS();
+        sample.drawMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - drawStartTime).count();
+        sample.particles = particleCount;
+        sample.threads = numThreads;
+        AddPhaseTimings(sample, frame.timings);
+        metrics.Log(sample);
+
         // Stop logging after 30 seconds
         if (elapsedTime >= loggingDuration) {
             break;
         }
     }
 
-    // Stop worker threads
-    stopThreads = true;
-    for (auto& thread : threads) {
-        if (thread.joinable()) {
-            thread.join();
-        }
-    }
+    graph.Wait();
+    metrics.Close();
 
-    // Save frame time log to CSV file
-    std::ofstream outFile("particle_frametime_multi.csv");
-    outFile << "Time (s),Frame Time (ms)\n";
-    for (const auto& entry : frameTimeLog) {
-        outFile << entry.first << "," << entry.second << "\n";
-    }
-    outFile.close();
+    // Per-worker timeline of the last frames, open in Perfetto. Only written by a TRACE=1 build.
+    if (TraceEnabled()) WriteChromeTrace("particle_trace_multi.json");
 
+    renderer.Unload();
     CloseWindow();
     return 0;
 }
@@ -2,33 +2,12 @@
 #include <raylib.h>
 #include <vector>
 #include <cmath>
-#include <fstream>
 #include <chrono>
 
-// Single particle position, velocity, radius and color
-struct Particle {
-    Vector2 position;
-    Vector2 velocity;
-    float radius;
-    Color color;
-};
-
-// Update particles position single-threaded
-void UpdateParticles(std::vector<Particle>& particles, float screenWidth, float screenHeight, float deltaTime) {
-    for (auto& p : particles) {
-        // Position
-        p.position.x += p.velocity.x * deltaTime;
-        p.position.y += p.velocity.y * deltaTime;
-
-        // Bounce off walls
-        if (p.position.x <= p.radius || p.position.x >= screenWidth - p.radius) {
-            p.velocity.x *= -1;
-        }
-        if (p.position.y <= p.radius || p.position.y >= screenHeight - p.radius) {
-            p.velocity.y *= -1;
-        }
-    }
-}
+#include "draw_batch.h"
+#include "metrics.h"
+#include "sim_clock.h"
+#include "world.h"
 
 int main() {
     const int screenWidth = 800;
@@ -36,23 +15,22 @@ int main() {
     InitWindow(screenWidth, screenHeight, "Single-threaded Physics Simulation");
 
     // Create particles
-    const int particleCount = 10000;
-    std::vector<Particle> particles;
-    particles.reserve(particleCount);
-
-    for (int i = 0; i < particleCount; i++) {
-        particles.push_back({
-            {(float)GetRandomValue(0, screenWidth), (float)GetRandomValue(0, screenHeight)},
-            {(float)GetRandomValue(-200, 200) / 100.0f, (float)GetRandomValue(-200, 200) / 100.0f},
-            (float)GetRandomValue(2, 5),
-            {(unsigned char)GetRandomValue(50, 255), (unsigned char)GetRandomValue(50, 255), (unsigned char)GetRandomValue(50, 255), 255}
-        });
-    }
+    WorldConfig config = DefaultConfig(Scenario::Bounce);
+    config.width = screenWidth;
+    config.height = screenHeight;
+    World world(config);
+    const int particleCount = world.ParticleCount();
 
     SetTargetFPS(0);
 
-    // Frame time logging
-    std::vector<std::pair<float, float>> frameTimeLog;
+    // Physics runs at a fixed rate whatever the frame rate, drawing blends the last two steps
+    FixedStepClock clock;
+    RenderSnapshot previous;
+    const float snapDistance = screenHeight / 2.0f;
+
+    // Frame metrics are queued to a background writer, Engine/physics_metrics_csv turns the file into CSV
+    MetricsLogger metrics;
+    metrics.Open("particle_frametime_single.metrics");
     auto startLoggingTime = std::chrono::high_resolution_clock::now();
     const float loggingDuration = 30.0f; // 30 seconds
 
@@ -60,25 +38,29 @@ int main() {
         // Measure frame time
         auto frameStartTime = std::chrono::high_resolution_clock::now();
 
-        // Update physics
-        float deltaTime = GetFrameTime();
-        UpdateParticles(particles, screenWidth, screenHeight, deltaTime);
+        // Update physics, keeping the state before the last step to interpolate from
+        int steps = clock.Advance(GetFrameTime());
+        for (int i = 0; i < steps; i++) {
+            if (i == steps - 1) world.WriteSnapshot(previous);
+            world.Step(clock.StepSeconds());
+        }
 
         // Measure update time
         auto frameEndTime = std::chrono::high_resolution_clock::now();
         float frameTime = std::chrono::duration<float, std::milli>(frameEndTime - frameStartTime).count();
 
-        // Log frame time
         auto currentTime = std::chrono::high_resolution_clock::now();
         float elapsedTime = std::chrono::duration<float>(currentTime - startLoggingTime).count();
-        frameTimeLog.push_back({elapsedTime, frameTime});
 
         // Draw particles
+        auto drawStartTime = std::chrono::high_resolution_clock::now();
         BeginDrawing();
         ClearBackground(BLACK);
 
-        for (const auto& p : particles) {
-            DrawCircleV(p.position, p.radius, p.color);
+        DrawSource source = MakeDrawSource(previous, world.Particles(), clock.Alpha(), snapDistance);
+        for (int i = 0; i < source.count; i++) {
+            Vec2 p = DrawPosition(source, i);
+            DrawCircleV({p.x, p.y}, source.radius[i], {source.color[i].r, source.color[i].g, source.color[i].b, source.color[i].a});
         }
 
         DrawText(TextFormat("Particles: %d", particleCount), 10, 10, 20, WHITE);
@@ -86,19 +68,25 @@ int main() {
 
         EndDrawing();
 
+        // Log the frame, the file is written on the logger's own thread
+        MetricsSample sample;
+        sample.time = elapsedTime;
+        sample.frameMs = GetFrameTime() * 1000.0f;
+        sample.fps = GetFPS();
+        sample.drawMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - drawStartTime).count();
+        sample.particles = particleCount;
+        sample.threads = 1;
+        AddPhaseTimings(sample, world.Timings());
+        world.ResetTimings();
+        metrics.Log(sample);
+
         // Stop logging after 30 seconds
         if (elapsedTime >= loggingDuration) {
             break;
         }
     }
 
-    // Save frame time log to CSV file
-    std::ofstream outFile("particle_frametime_single.csv");
-    outFile << "Time (s),Frame Time (ms)\n";
-    for (const auto& entry : frameTimeLog) {
-        outFile << entry.first << "," << entry.second << "\n";
-    }
-    outFile.close();
+    metrics.Close();
 
     CloseWindow();
     return 0;
@@ -1,100 +1,76 @@
 // This is a combined example of both single and multi rain programs
 
 #include <raylib.h>
-#include <vector>
-#include <thread>
-#include <mutex>
 #include <cstdlib>
 
+#include "batch_renderer.h"
+#include "scheduler.h"
+#include "sim_clock.h"
+#include "trace.h"
+#include "world.h"
+
 #define SCREEN_WIDTH 800
 #define SCREEN_HEIGHT 600
 #define RAIN_COUNT 25000
 
-// Single raindrop position and speed
-struct Raindrop {
-    Vector2 position;
-    float speed;
-};
-
-std::vector<Raindrop> rain;
-std::vector<Raindrop> rainRender;
-std::mutex rainMutex;
-bool running = true;
 bool multiThreaded = false;
+bool batched = true;
 
 // Smoothing counters variables
 float smoothedFps = 0.0f;
 float smoothedFrameTime = 0.0f;
 const float alpha = 0.1f;
 
-// Initialize all raindrops
-void InitRain() {
-    rain.clear();
-    for (int i = 0; i < RAIN_COUNT; i++) {
-        rain.push_back({{(float)(rand() % SCREEN_WIDTH), (float)(rand() % SCREEN_HEIGHT)}, 300.0f + (rand() % 200)});
-    }
-}
-
-// Update raindrops single-threaded
-void UpdateRainSingle(float dt) {
-    for (auto &drop : rain) {
-        drop.position.y += drop.speed * dt;
-        if (drop.position.y > SCREEN_HEIGHT) {
-            drop.position = {(float)(rand() % SCREEN_WIDTH), -10.0f};
-        }
-    }
-}
-
-// Update raindrops multi-threaded
-void UpdateRainMulti() {
-    while (running) {
-        float dt = GetFrameTime();
-        {
-            std::lock_guard<std::mutex> lock(rainMutex);
-            for (auto &drop : rain) {
-                drop.position.y += drop.speed * dt;
-                if (drop.position.y > SCREEN_HEIGHT) {
-                    drop.position = {(float)(rand() % SCREEN_WIDTH), -10.0f};
-                }
-            }
-        }
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+// Draw the raindrops straight from the world, the step has finished before drawing starts
+void DrawRain(const DrawSource& source) {
+    for (int i = 0; i < source.count; i++) {
+        Vec2 drop = DrawPosition(source, i);
+        DrawLineV({drop.x, drop.y}, {drop.x, drop.y + 10}, BLUE);
     }
 }
 
-// Draw the raindrops thread-safe
-void DrawRain() {
-    if (multiThreaded) {
-        std::lock_guard<std::mutex> lock(rainMutex);
-        rainRender = rain;
-    } else {
-        rainRender = rain;
-    }
-    
-    for (const auto &drop : rainRender) {
-        DrawLineV(drop.position, {drop.position.x, drop.position.y + 10}, BLUE);
-    }
-}
+int main(int argc, char** argv) {
+    // Drop count can be passed on the command line to benchmark larger storms
+    const int rainCount = argc > 1 ? atoi(argv[1]) : RAIN_COUNT;
 
-int main() {
     InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Heavy Rain Simulation");
     SetTargetFPS(0);
-    InitRain();
-    std::thread physicsThread;
+
+    // Initialize all raindrops
+    WorldConfig config = DefaultConfig(Scenario::Rain);
+    config.width = SCREEN_WIDTH;
+    config.height = SCREEN_HEIGHT;
+    config.particleCount = rainCount;
+    World simulation(config);
+
+    // Multi threaded mode splits the drops across every core
+    WorkerPool pool;
+    TaskScheduler scheduler(pool);
+
+    // Batched drawing puts every streak in one vertex buffer and one draw call
+    BatchRenderer renderer;
+    renderer.Load();
+    DrawBatch batch;
+
+    // Physics runs at a fixed rate whatever the frame rate, drawing blends the last two steps
+    FixedStepClock clock;
+    RenderSnapshot previous;
 
     // Main simulation loop
+    TRACE_THREAD_NAME("Main");
     while (!WindowShouldClose()) {
+        TRACE_ZONE("Frame");
+
         // Toggle between single and multi-threaded mode using spacebar
         if (IsKeyPressed(KEY_SPACE)) {
             multiThreaded = !multiThreaded;
-            InitRain();
-            if (multiThreaded) {
-                running = true;
-                physicsThread = std::thread(UpdateRainMulti);
-            } else {
-                running = false;
-                if (physicsThread.joinable()) physicsThread.join();
-            }
+            simulation.Reset();
+            clock.Reset();
+        }
+
+        // Toggle batched and per-drop drawing with B
+        if (IsKeyPressed(KEY_B)) {
+            batched = !batched;
         }
 
         float dt = GetFrameTime();
@@ -104,25 +80,47 @@ int main() {
         smoothedFps = alpha * fps + (1.0f - alpha) * smoothedFps;
         smoothedFrameTime = alpha * (dt * 1000.0f) + (1.0f - alpha) * smoothedFrameTime;
 
-        if (!multiThreaded) {
-            UpdateRainSingle(dt);
+        int steps = clock.Advance(dt);
+        for (int i = 0; i < steps; i++) {
+            if (multiThreaded) {
+                if (i == steps - 1) simulation.WriteSnapshot(previous, scheduler);
+                simulation.Step(clock.StepSeconds(), scheduler);
+            } else {
+                if (i == steps - 1) simulation.WriteSnapshot(previous);
+                simulation.Step(clock.StepSeconds());
+            }
+        }
+
+        DrawSource source = MakeDrawSource(previous, simulation.Particles(), clock.Alpha(), SCREEN_HEIGHT / 2.0f);
+        if (batched) {
+            if (multiThreaded) {
+                batch.BuildStreaks(source, 10.0f, 1.0f, {0, 121, 241, 255}, scheduler);
+            } else {
+                batch.BuildStreaks(source, 10.0f, 1.0f, {0, 121, 241, 255});
+            }
         }
 
         BeginDrawing();
         ClearBackground(DARKGRAY);
-        DrawRain();
+        if (batched) {
+            renderer.Draw(batch);
+        } else {
+            DrawRain(source);
+        }
         DrawText(multiThreaded ? "Heavy Rain Simulation (Multi Thread)" : "Heavy Rain Simulation (Single Thread)", 10, 10, 20, WHITE);
-        DrawText(TextFormat("Rain Particles: %d", RAIN_COUNT), 10, 40, 20, YELLOW);
-        DrawText("Press SPACE to switch modes", 10, 70, 20, RED);
+        DrawText(TextFormat("Rain Particles: %d", rainCount), 10, 40, 20, YELLOW);
+        DrawText("Press SPACE to switch modes, B to toggle batching", 10, 70, 20, RED);
+        DrawText(batched ? "Drawing: Batched" : "Drawing: Per drop", 10, 100, 20, WHITE);
         
         DrawText(TextFormat("CURRENT FPS: %.1f", smoothedFps), GetScreenWidth() - 220, 40, 20, WHITE);
 
         EndDrawing();
     }
     
-    // Ensure the thread is safely stopped on exit
-    running = false;
-    if (physicsThread.joinable()) physicsThread.join();
+    // Only written by a TRACE=1 build
+    if (TraceEnabled()) WriteChromeTrace("rain_trace_combined.json");
+
+    renderer.Unload();
     CloseWindow();
     return 0;
 }
@@ -1,91 +1,134 @@
 // Multi threaded rain example
 
 #include <raylib.h>
-#include <vector>
-#include <thread>
-#include <mutex>
+#include <atomic>
+#include <chrono>
 #include <cstdlib>
-#include <fstream>
+#include <thread>
+
+#include "batch_renderer.h"
+#include "metrics.h"
+#include "scheduler.h"
+#include "sim_clock.h"
+#include "trace.h"
+#include "world.h"
 
 #define SCREEN_WIDTH 800
 #define SCREEN_HEIGHT 600
 #define RAIN_COUNT 25000
 
-// Single raindrop position and speed
-struct Raindrop {
-    Vector2 position;
-    float speed;
-};
-
-std::vector<Raindrop> rain;
-std::vector<Raindrop> rainRender;
-std::mutex rainMutex;
-bool running = true;
+std::atomic<bool> running(true);
 
-// Initialize all raindrops
-void InitRain() {
-    for (int i = 0; i < RAIN_COUNT; i++) {
-        rain.push_back({{(float)(rand() % SCREEN_WIDTH), (float)(rand() % SCREEN_HEIGHT)}, 300.0f + (rand() % 200)});
-    }
-}
+// One published step: the world state, the streaks already built from it and the physics time spent so far
+struct RainFrame {
+    RenderSnapshot snapshot;
+    DrawBatch batch;
+    PhaseTimings timings;
+};
 
-// Multi-threading for updating raindrop positions
-void UpdateRainPhysics() {
+// Physics runs on its own thread at a fixed step rate on its own clock and publishes every finished step, it
+// never waits for the renderer. Between steps it sleeps instead of spinning.
+void UpdateRainPhysics(World& world, TaskScheduler& scheduler, TripleBuffer<RainFrame>& frames) {
+    TRACE_THREAD_NAME("Physics");
+    FixedStepClock clock;
+    auto lastTime = std::chrono::steady_clock::now();
     while (running) {
-        float dt = GetFrameTime();
-        {
-            std::lock_guard<std::mutex> lock(rainMutex);
-            for (auto &drop : rain) {
-                drop.position.y += drop.speed * dt;
-                if (drop.position.y > SCREEN_HEIGHT) {
-                    drop.position = {(float)(rand() % SCREEN_WIDTH), -10.0f};
-                }
-            }
+        auto now = std::chrono::steady_clock::now();
+        int steps = clock.Advance(std::chrono::duration<double>(now - lastTime).count());
+        lastTime = now;
+
+        if (steps == 0) {
+            std::this_thread::sleep_for(std::chrono::duration<double>(clock.TimeToNextStep()));
+            continue;
+        }
+        TRACE_ZONE("Physics Frame");
+        for (int i = 0; i < steps; i++) {
+            world.Step(clock.StepSeconds(), scheduler);
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
-    }
-}
 
-// Draw the raindrops thread-safe
-void DrawRain() {
-    std::lock_guard<std::mutex> lock(rainMutex);
-    rainRender = rain;
-    for (const auto &drop : rainRender) {
-        DrawLineV(drop.position, {drop.position.x, drop.position.y + 10}, BLUE);
+        // The workers build the streak vertices too, the render thread only uploads them
+        RainFrame& frame = frames.WriteSlot();
+        world.WriteSnapshot(frame.snapshot, scheduler);
+        frame.batch.BuildStreaks(MakeDrawSource(frame.snapshot), 10.0f, 1.0f, {0, 121, 241, 255}, scheduler);
+        frame.timings = world.Timings();
+        frames.Publish();
     }
 }
 
-int main() {
+int main(int argc, char** argv) {
+    // Drop count can be passed on the command line to benchmark larger storms
+    const int rainCount = argc > 1 ? atoi(argv[1]) : RAIN_COUNT;
+
     InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Heavy Rain Simulation - Multi Thread");
     SetTargetFPS(0);
-    InitRain();
-    std::thread physicsThread(UpdateRainPhysics);
 
-    std::ofstream fpsFile("rain_fps_multi.csv");
-    fpsFile << "Time, FPS\n";
+    // Initialize all raindrops
+    WorldConfig config = DefaultConfig(Scenario::Rain);
+    config.width = SCREEN_WIDTH;
+    config.height = SCREEN_HEIGHT;
+    config.particleCount = rainCount;
+    World world(config);
+
+    // Every core updates its own slice of the drops, no lock is held while they run
+    WorkerPool pool;
+    TaskScheduler scheduler(pool);
+
+    BatchRenderer renderer;
+    renderer.Load();
+
+    TripleBuffer<RainFrame> frames;
+    std::thread physicsThread(UpdateRainPhysics, std::ref(world), std::ref(scheduler), std::ref(frames));
+
+    // Frame metrics are queued to a background writer, Engine/physics_metrics_csv turns the file into CSV.
+    // Frames carry running totals, so the difference between two frames is the physics time in between even
+    // when the renderer skipped some of them.
+    MetricsLogger metrics;
+    metrics.Open("rain_fps_multi.metrics");
+    PhaseTimings loggedTimings;
 
     double startTime = GetTime();
 
     // Main simulation loop
+    TRACE_THREAD_NAME("Render");
     while (!WindowShouldClose()) {
+        TRACE_ZONE("Frame");
         double elapsedTime = GetTime() - startTime;
         if (elapsedTime >= 30.0) break;
 
-        int currentFPS = GetFPS();
-        fpsFile << elapsedTime << ", " << currentFPS << "\n";
+        // Latest finished step, physics keeps writing the other two buffers meanwhile
+        const RainFrame& frame = frames.Acquire();
 
+        auto drawStartTime = std::chrono::steady_clock::now();
         BeginDrawing();
         ClearBackground(DARKGRAY);
-        DrawRain();
+        renderer.Draw(frame.batch);
         DrawText("Heavy Rain Simulation (Multi Thread)", 10, 10, 20, WHITE);
-        DrawText(TextFormat("Rain Particles: %d", RAIN_COUNT), 10, 40, 20, YELLOW);
+        DrawText(TextFormat("Rain Particles: %d", rainCount), 10, 40, 20, YELLOW);
+        DrawText(TextFormat("Threads: %d", pool.ThreadCount()), 10, 70, 20, WHITE);
+        DrawText(TextFormat("Physics Steps: %lld", frame.snapshot.step), 10, 100, 20, WHITE);
         EndDrawing();
+
+        // Log the frame, the file is written on the logger's own thread
+        MetricsSample sample;
+        sample.time = elapsedTime;
+        sample.frameMs = GetFrameTime() * 1000.0f;
+        sample.fps = GetFPS();
+        sample.drawMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - drawStartTime).count();
+        sample.particles = rainCount;
+        sample.threads = pool.ThreadCount();
+        AddPhaseTimings(sample, frame.timings - loggedTimings);
+        loggedTimings = frame.timings;
+        metrics.Log(sample);
     }
 
     // Ensure the thread is safely stopped on exit
     running = false;
     physicsThread.join();
-    fpsFile.close();
+    metrics.Close();
+
+    // Shows the physics thread and the workers next to the render thread. Only written by a TRACE=1 build.
+    if (TraceEnabled()) WriteChromeTrace("rain_trace_multi.json");
+    renderer.Unload();
     CloseWindow();
     return 0;
 }
@@ -2,76 +2,81 @@
 
 #include <raylib.h>
 #include <vector>
+#include <chrono>
 #include <cstdlib>
-#include <fstream>
+
+#include "draw_batch.h"
+#include "metrics.h"
+#include "sim_clock.h"
+#include "world.h"
 
 #define SCREEN_WIDTH 800
 #define SCREEN_HEIGHT 600
 #define RAIN_COUNT 25000
 
-// Single raindrop position and speed
-struct Raindrop {
-    Vector2 position;
-    float speed;
-};
-
-std::vector<Raindrop> rain;
-
-// Initialize all raindrops
-void InitRain() {
-    for (int i = 0; i < RAIN_COUNT; i++) {
-        rain.push_back({{(float)(rand() % SCREEN_WIDTH), (float)(rand() % SCREEN_HEIGHT)}, 300.0f + (rand() % 200)});
-    }
-}
-
-// Update the position of each raindrop based on speed and time
-void UpdateRain(float dt) {
-    for (auto &drop : rain) {
-        drop.position.y += drop.speed * dt;
-        if (drop.position.y > SCREEN_HEIGHT) {
-            drop.position = {(float)(rand() % SCREEN_WIDTH), -10.0f};
-        }
-    }
-}
-
 // Draw each raindrop
-void DrawRain() {
-    for (const auto &drop : rain) {
-        DrawLineV(drop.position, {drop.position.x, drop.position.y + 10}, BLUE);
+void DrawRain(const DrawSource& source) {
+    for (int i = 0; i < source.count; i++) {
+        Vec2 drop = DrawPosition(source, i);
+        DrawLineV({drop.x, drop.y}, {drop.x, drop.y + 10}, BLUE);
     }
 }
 
 int main() {
     InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Heavy Rain Simulation - Single Thread");
     SetTargetFPS(0);
-    InitRain();
 
-    std::ofstream fpsFile("rain_fps_single.csv");
-    fpsFile << "Time, FPS\n";
+    // Initialize all raindrops
+    WorldConfig config = DefaultConfig(Scenario::Rain);
+    config.width = SCREEN_WIDTH;
+    config.height = SCREEN_HEIGHT;
+    config.particleCount = RAIN_COUNT;
+    World world(config);
+
+    // Physics runs at a fixed rate whatever the frame rate, drawing blends the last two steps
+    FixedStepClock clock;
+    RenderSnapshot previous;
+
+    // Frame metrics are queued to a background writer, Engine/physics_metrics_csv turns the file into CSV
+    MetricsLogger metrics;
+    metrics.Open("rain_fps_single.metrics");
 
     double startTime = GetTime();
 
     // Main simulation loop that runs for 30 seconds
     while (!WindowShouldClose()) {
-        float dt = GetFrameTime();
-        int currentFPS = GetFPS();
         double elapsedTime = GetTime() - startTime;
 
-        fpsFile << elapsedTime << ", " << currentFPS << "\n";
-
-        UpdateRain(dt);
+        int steps = clock.Advance(GetFrameTime());
+        for (int i = 0; i < steps; i++) {
+            if (i == steps - 1) world.WriteSnapshot(previous);
+            world.Step(clock.StepSeconds());
+        }
 
+        auto drawStartTime = std::chrono::high_resolution_clock::now();
         BeginDrawing();
         ClearBackground(DARKGRAY);
-        DrawRain();
+        DrawRain(MakeDrawSource(previous, world.Particles(), clock.Alpha(), SCREEN_HEIGHT / 2.0f));
         DrawText("Heavy Rain Simulation (Single Thread)", 10, 10, 20, WHITE);
         DrawText(TextFormat("Rain Particles: %d", RAIN_COUNT), 10, 40, 20, YELLOW);
         EndDrawing();
 
+        // Log the frame, the file is written on the logger's own thread
+        MetricsSample sample;
+        sample.time = elapsedTime;
+        sample.frameMs = GetFrameTime() * 1000.0f;
+        sample.fps = GetFPS();
+        sample.drawMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - drawStartTime).count();
+        sample.particles = RAIN_COUNT;
+        sample.threads = 1;
+        AddPhaseTimings(sample, world.Timings());
+        world.ResetTimings();
+        metrics.Log(sample);
+
         if (elapsedTime >= 30.0) break;
     }
 
-    fpsFile.close();
+    metrics.Close();
     CloseWindow();
     return 0;
 }
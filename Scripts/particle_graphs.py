@@ -3,15 +3,17 @@ import matplotlib.pyplot as plt
 import numpy as np
 
 
-def bargraph():
-    df1 = pd.read_csv('particle_single.csv')
-    df2 = pd.read_csv('particle_multi.csv')
+def load_frames(path):
+    # Output of Engine/physics_metrics_csv, columns are picked by name since later ones were added over time
+    df = pd.read_csv(path)
+    return df[['time_s', 'frame_ms']].sort_values(by='time_s')
 
-    y1 = df1.columns[1]
-    y2 = df2.columns[1]
+def bargraph():
+    df1 = load_frames('particle_single.csv')
+    df2 = load_frames('particle_multi.csv')
 
-    avg_single = df1[y1].mean() * 1000
-    avg_multi = df2[y2].mean() * 1000
+    avg_single = df1['frame_ms'].mean()
+    avg_multi = df2['frame_ms'].mean()
 
     print(avg_single)
     print(avg_multi)
@@ -22,72 +24,108 @@ def bargraph():
     plt.figure(figsize=(8,5))
     plt.bar(labels, averages, color=['blue', 'green'], width=.6)
 
-    plt.ylabel(df1.columns[1])
+    plt.ylabel('Frame Time (ms)')
     plt.title('Particle Average Frame Time')
 
     for i, v in enumerate(averages):
-        plt.text(i, v + 1, f"{v:.2f}", ha='center')
+        plt.text(i, v * 1.01, f"{v:.2f}", ha='center', va='bottom')
 
     plt.show()
 
 def linegraph():
-    df1 = pd.read_csv('particle_single.csv')
-    df2 = pd.read_csv('particle_multi.csv')
-
-    x1, y1 = df1.columns[0], df1.columns[1]
-    x2, y2 = df2.columns[0], df2.columns[1]
+    df1 = load_frames('particle_single.csv')
+    df2 = load_frames('particle_multi.csv')
 
     plt.figure(figsize=(8,5))
 
-    plt.plot(df1[x1], df1[y1], label='FPS Single')
-    plt.plot(df2[x2], df2[y2], label='FPS Multi')
+    plt.plot(df1['time_s'], df1['frame_ms'], label='Single')
+    plt.plot(df2['time_s'], df2['frame_ms'], label='Multi')
 
-    plt.xlabel(df1.columns[0])
-    plt.ylabel(df1.columns[1])
-    plt.ylim([-0.01, 0.09])
-    plt.title('Particle FPS Single vs Multi')
+    plt.xlabel('Time (s)')
+    plt.ylabel('Frame Time (ms)')
+    plt.ylim(bottom=0)
+    plt.title('Particle Frame Time Single vs Multi')
     plt.legend()
     plt.tight_layout()
 
     plt.show()
 
 def scatter_bf():
-    df1 = pd.read_csv('particle_single.csv')
-    df2 = pd.read_csv('particle_multi.csv')
-
-    x1, y1 = df1.columns[0], df1.columns[1]
-    x2, y2 = df2.columns[0], df2.columns[1]
-
-    df1_sorted = df1.sort_values(by=x1)
-    df2_sorted = df2.sort_values(by=x2)
+    df1 = load_frames('particle_single.csv')
+    df2 = load_frames('particle_multi.csv')
 
     plt.figure(figsize=(8,5))
 
-    plt.plot(df1[x1], df1[y1], label='FPS Single')
-    plt.plot(df2[x2], df2[y2], label='FPS Multi')
+    plt.plot(df1['time_s'], df1['frame_ms'], label='Single')
+    plt.plot(df2['time_s'], df2['frame_ms'], label='Multi')
 
 
-    coeffs_single = np.polyfit(df1_sorted[x1], df1_sorted[y1], 1)
+    coeffs_single = np.polyfit(df1['time_s'], df1['frame_ms'], 1)
     poly_single = np.poly1d(coeffs_single)
-    best_fit_single = poly_single(df1_sorted[x1])
-    plt.plot(df1_sorted[x1], best_fit_single, color='red', linestyle='--')
+    best_fit_single = poly_single(df1['time_s'])
+    plt.plot(df1['time_s'], best_fit_single, color='red', linestyle='--')
 
 
-    coeffs_multi = np.polyfit(df2_sorted[x2], df2_sorted[y2], 1)
+    coeffs_multi = np.polyfit(df2['time_s'], df2['frame_ms'], 1)
     poly_multi = np.poly1d(coeffs_multi)
-    best_fit_multi = poly_multi(df2_sorted[x2])
-    plt.plot(df2_sorted[x2], best_fit_multi, color='green', linestyle='--')
+    best_fit_multi = poly_multi(df2['time_s'])
+    plt.plot(df2['time_s'], best_fit_multi, color='green', linestyle='--')
 
 
-    plt.xlabel(df1.columns[0])
-    plt.ylabel(df1.columns[1])
-    plt.title('Particle FPS Single vs Multi')
+    plt.xlabel('Time (s)')
+    plt.ylabel('Frame Time (ms)')
+    plt.ylim(bottom=0)
+    plt.title('Particle Frame Time Single vs Multi')
     plt.legend()
     plt.tight_layout()
 
     plt.show()
 
 
+def load_bench(path):
+    # Output of Engine/physics_bench, either --format csv or --format json
+    if path.endswith('.json'):
+        return pd.read_json(path)
+    return pd.read_csv(path)
+
+def scaling(scenario='bounce', path='bench.csv'):
+    df = load_bench(path)
+    df = df[df['scenario'] == scenario]
+
+    fig, (ax1, ax2) = plt.subplots(1, 2, figsize=(12,5))
+
+    # Median step time per particle count, p99 dashed, one line per thread count
+    for threads, group in df.groupby('threads'):
+        group = group.sort_values(by='count')
+        line, = ax1.plot(group['count'], group['median_ms'], marker='o', label=f'{threads} threads')
+        ax1.plot(group['count'], group['p99_ms'], linestyle='--', color=line.get_color())
+
+    ax1.set_xscale('log')
+    ax1.set_yscale('log')
+    ax1.set_xlabel('Particles')
+    ax1.set_ylabel('Step Time (ms), median and p99')
+    ax1.set_title('Particle Step Time vs Particle Count')
+    ax1.legend()
+
+    # Speedup over one thread for each particle count
+    single = df[df['threads'] == 1].set_index('count')['median_ms']
+    for count, group in df.groupby('count'):
+        if count not in single.index:
+            continue
+        group = group.sort_values(by='threads')
+        ax2.plot(group['threads'], single[count] / group['median_ms'], marker='o', label=f'{count} particles')
+
+    ax2.set_xlabel('Threads')
+    ax2.set_ylabel('Speedup over 1 thread')
+    ax2.set_title('Particle Thread Scaling')
+    ax2.legend()
+
+    plt.tight_layout()
+    plt.show()
+
+
 bargraph()
 # linegraph()
-# scatter_bf()
\ No newline at end of file
+# scatter_bf()
+# scaling()
+# scaling('game')